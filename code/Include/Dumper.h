@@ -27,5 +27,28 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define arraysz(x) (sizeof(x) / sizeof(*x))
 
 typedef std::vector < mpz_class > number_list_t;
+
+//hash of the limbs, so that equal numbers land in the same bucket
+struct big_hash_t
+{
+	size_t operator()( const mpz_class & n ) const
+	{
+		const mpz_srcptr z = n.get_mpz_t();
+		const size_t limbs = mpz_size( z );
+		size_t h = 2166136261u ^ (size_t)mpz_sgn( z );
+		for( size_t i = 0; i < limbs; ++i )
+		{
+			h = (h ^ (size_t)mpz_getlimbn( z, i )) * 16777619u;
+		}
+		return h;
+	}
+};
 extern std::string guess_relations( number_list_t & numbers );
+
+//bit i is set for the bytes of alphabets[ i ] in Dumper.cpp
+extern unsigned char alphabet_masks[ 256 ];
+//bit i of the result is set when every byte belongs to alphabets[ i ]
+extern unsigned int classify_text( const unsigned char * data, size_t size );
+//text in alphabets[ base_idx - 1 ] to a number, as settings_t::dump does it
+extern void text_to_number( const unsigned char * text, size_t len, int base_idx, int bignum_endian, mpz_class & number );
 extern bool wasbreak( void );
\ No newline at end of file
@@ -0,0 +1,115 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#pragma once
+
+#include <mpir.h>
+#include <mpirxx.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <pro.h>
+#include "trace_log.h"
+
+//byte ring for one writer and one reader thread, no locks on either side
+//every record is prefixed by its length and padded to 8 bytes, a record that does not fit before the end
+//leaves a wrap marker there and starts again at the beginning
+class capture_ring_t
+{
+public:
+	capture_ring_t( size_t capacity );
+
+	//writer: room for max_size bytes or NULL when the ring is full, nothing is visible before end_write
+	unsigned char * begin_write( size_t max_size );
+	//writer: publishes the first size bytes of the reserved room
+	void end_write( size_t size );
+
+	//reader: the oldest record or NULL when the ring is empty
+	const unsigned char * begin_read( size_t & size );
+	//reader: frees the record returned by begin_read
+	void end_read();
+
+private:
+	std::vector<unsigned char> buffer;
+	//written by the writer only
+	std::atomic<size_t> head;
+	//written by the reader only
+	std::atomic<size_t> tail;
+	//the reservation of the writer and the record of the reader
+	size_t write_at;
+	size_t read_at;
+	size_t read_size;
+};
+
+//what the breakpoint asked for, followed by the raw bytes in the ring
+struct capture_entry_t
+{
+	uint64 address;
+	uint64 call_site;
+	uint64 sequence;
+	uint64 time;
+	int32 word_size;
+	int32 base_idx;
+	int32 word_endian;
+	int32 bignum_endian;
+};
+
+struct captured_number_t
+{
+	mpz_class number;
+	trace_hit_t hit;
+};
+
+//breakpoint hits copy their bytes into the ring and return, a thread turns them into numbers in batches
+//and the UI thread picks the numbers up with collect()
+class capture_t
+{
+public:
+	capture_t( size_t capacity );
+	~capture_t();
+
+	//UI thread: room for the entry and max_size bytes, NULL when the ring is full
+	unsigned char * begin( const capture_entry_t & entry, size_t max_size );
+	//UI thread: publishes the entry with size bytes, without commit the room is just not used
+	void commit( size_t size );
+
+	//UI thread: the numbers decoded since the last call, false when there were none
+	bool collect( std::vector<captured_number_t> & numbers );
+
+	//waits for the decoder, the captured bytes nobody decoded yet are lost
+	void shutdown();
+
+private:
+	void decoder();
+
+	size_t capacity;
+	std::unique_ptr<capture_ring_t> ring;
+	std::thread thread;
+	std::atomic<bool> stop;
+	std::mutex lock;
+	std::vector<captured_number_t> decoded;
+};
@@ -0,0 +1,38 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#pragma once
+
+#include <mpir.h>
+#include <mpirxx.h>
+#include <vector>
+
+//number from digit values 0..base-1, most significant first
+//mpn_set_str packs the bits for the power of two bases and converts the others divide-and-conquer,
+//so multi-kilobyte decimal or base58 strings are not quadratic
+void digits_to_number( const unsigned char * digits, size_t count, unsigned int base, mpz_class & number );
+
+//number = number*base^digits.size() + digits, the digits are consumed
+void append_digits( mpz_class & number, std::vector<unsigned char> & digits, unsigned int base );
@@ -0,0 +1,57 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#define DER_INTEGER 0x02
+#define DER_BIT_STRING 0x03
+#define DER_OCTET_STRING 0x04
+#define DER_SEQUENCE 0x30
+#define DER_CONSTRUCTED 0x20
+
+//one tag-length-value, the offsets point into the walked buffer, nothing is copied
+struct der_tlv_t
+{
+	unsigned char tag;
+	//of the tag
+	size_t position;
+	//of the contents
+	size_t offset;
+	size_t length;
+};
+
+//the tag and the length at data[ pos ], the contents may lie beyond size
+//BER lengths in the long form are accepted, the indefinite length is not
+bool der_read_header( const unsigned char * data, size_t size, size_t pos, der_tlv_t & tlv );
+
+//the same, the contents must end within size
+bool der_read_tlv( const unsigned char * data, size_t size, size_t pos, der_tlv_t & tlv );
+
+//every INTEGER of the structure at data[ 0 ] in order, also inside OCTET STRING and BIT STRING wrappers
+//for a PKCS#1 RSAPrivateKey these are the version and the eight key fields
+bool der_integers( const unsigned char * data, size_t size, std::vector<der_tlv_t> & integers );
@@ -2,6 +2,8 @@
 
 #include <mpir.h>
 #include <mpirxx.h>
+#include <vector>
+#include "field.h"
 
 class ec_point_t
 {
@@ -26,14 +28,42 @@ public:
 			return false;
 		return true;
 	}
-	//todo:
-	//mpz_class z;
+};
+
+//Jacobian coordinates (X : Y : Z) of the affine point (X/Z^2, Y/Z^3), Z == 0 is the point at infinity
+//the additions need no inversion, only the final conversion to affine does
+//F is one of the fields from field.h
+template <typename F> class ec_jacobian_t
+{
+public:
+	typename F::value_t x;
+	typename F::value_t y;
+	typename F::value_t z;
+};
+
+//projective coordinates (X : Y : Z) of the affine point (X/Z, Y/Z), used by the Edwards forms
+template <typename F> class ec_projective_t
+{
+public:
+	typename F::value_t x;
+	typename F::value_t y;
+	typename F::value_t z;
+};
+
+//odd multiples base, 3*base, 5*base, ... up to (2^(w-1)-1)*base for the width-w NAF
+//built once per point and reused for every scalar tried with it
+class ec_table_t
+{
+public:
+	unsigned int w;
+	std::vector<ec_point_t> odd;
 };
 
 
 class elliptic_curve_t
 {
 public:
+	virtual ~elliptic_curve_t() {}
 	bool is_zero();
 	virtual ec_point_t plus( const ec_point_t &, const ec_point_t & ) = 0;
 	virtual ec_point_t one() = 0;
@@ -41,8 +71,15 @@ public:
 	virtual bool test( const ec_point_t  & ) = 0;
 	virtual bool same( elliptic_curve_t * other ) = 0;
 	virtual int get_id() = 0;
+	virtual const mpz_class & modulus() = 0;
 
-	ec_point_t elliptic_curve_t::times( mpz_class m, const ec_point_t r );
+	//uses is the number of scalars that will be tried with the table, the window width is chosen from it
+	virtual void elliptic_curve_t::precompute( const ec_point_t & r, size_t uses, ec_table_t & table );
+	virtual ec_point_t elliptic_curve_t::times( const mpz_class & m, const ec_table_t & table );
+	//r[ i ] = m[ i ] * base of the table, the curves with projective formulas convert all results with one inversion
+	virtual void elliptic_curve_t::times( const std::vector<mpz_class> & m, const ec_table_t & table, std::vector<ec_point_t> & r );
+
+	ec_point_t elliptic_curve_t::times( const mpz_class & m, const ec_point_t & r );
 
 	
 	
@@ -60,12 +97,21 @@ public:
 	virtual bool ShortWeierstrass::test( const ec_point_t & p );
 	virtual ec_point_t ShortWeierstrass::one();
 	virtual ec_point_t ShortWeierstrass::inverse( const ec_point_t  & p1 );
+	virtual void ShortWeierstrass::precompute( const ec_point_t & r, size_t uses, ec_table_t & table );
+	virtual ec_point_t ShortWeierstrass::times( const mpz_class & m, const ec_table_t & table );
+	virtual void ShortWeierstrass::times( const std::vector<mpz_class> & m, const ec_table_t & table, std::vector<ec_point_t> & r );
+	using elliptic_curve_t::times;
 
 	virtual int get_id()
 	{
 		return 0;
 	}
 
+	virtual const mpz_class & modulus()
+	{
+		return n;
+	}
+
 	virtual bool same( elliptic_curve_t * other )
 	{
 		if( !other )
@@ -86,7 +132,6 @@ public:
 			return false;
 		return true;
 	}
-	
 };
 
 class TwistedEdwards: public elliptic_curve_t
@@ -101,12 +146,21 @@ public:
 	virtual bool TwistedEdwards::test( const ec_point_t & p );
 	virtual ec_point_t TwistedEdwards::one();
 	virtual ec_point_t TwistedEdwards::inverse( const ec_point_t  & p1 );
+	virtual void TwistedEdwards::precompute( const ec_point_t & r, size_t uses, ec_table_t & table );
+	virtual ec_point_t TwistedEdwards::times( const mpz_class & m, const ec_table_t & table );
+	virtual void TwistedEdwards::times( const std::vector<mpz_class> & m, const ec_table_t & table, std::vector<ec_point_t> & r );
+	using elliptic_curve_t::times;
 
 	virtual int get_id()
 	{
 		return 1;
 	}
 
+	virtual const mpz_class & modulus()
+	{
+		return n;
+	}
+
 	virtual bool same( elliptic_curve_t * other )
 	{
 		if( !other )
@@ -142,12 +196,21 @@ public:
 	virtual bool Edwards::test( const ec_point_t & p );
 	virtual ec_point_t Edwards::one();
 	virtual ec_point_t Edwards::inverse( const ec_point_t  & p1 );
+	virtual void Edwards::precompute( const ec_point_t & r, size_t uses, ec_table_t & table );
+	virtual ec_point_t Edwards::times( const mpz_class & m, const ec_table_t & table );
+	virtual void Edwards::times( const std::vector<mpz_class> & m, const ec_table_t & table, std::vector<ec_point_t> & r );
+	using elliptic_curve_t::times;
 
 	virtual int get_id()
 	{
 		return 2;
 	}
 
+	virtual const mpz_class & modulus()
+	{
+		return n;
+	}
+
 	virtual bool same( elliptic_curve_t * other )
 	{
 		if( !other )
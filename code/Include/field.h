@@ -0,0 +1,301 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#pragma once
+
+#include <mpir.h>
+#include <mpirxx.h>
+#include <vector>
+#include "modular.h"
+
+//the fields below share one interface, so the curve formulas and the exponentiation tables are written once as templates
+//value_t is the element, set() reduces an arbitrary number into the field and get() returns it in [0, n)
+
+//elements are MPIR numbers, works for every modulus
+class mpz_field_t
+{
+public:
+	typedef mpz_class value_t;
+
+	mpz_field_t( const mpz_class & modulus ): ctx( modulus )
+	{
+	}
+
+	const mpz_class & modulus() const
+	{
+		return ctx.modulus();
+	}
+
+	void set( value_t & r, const mpz_class & a ) const
+	{
+		ctx.reduce( r, a );
+	}
+
+	mpz_class get( const value_t & a ) const
+	{
+		return a;
+	}
+
+	void mul( value_t & r, const value_t & a, const value_t & b ) const
+	{
+		ctx.mul( r, a, b );
+	}
+
+	void add( value_t & r, const value_t & a, const value_t & b ) const
+	{
+		r = a + b;
+		if( r >= ctx.modulus() )
+			r -= ctx.modulus();
+	}
+
+	void sub( value_t & r, const value_t & a, const value_t & b ) const
+	{
+		r = a - b;
+		if( r < 0 )
+			r += ctx.modulus();
+	}
+
+	//r = 1/a, false and r == 0 when a has no inverse
+	bool invert( value_t & r, const value_t & a ) const
+	{
+		if( mpz_invert( r.get_mpz_t(), a.get_mpz_t(), ctx.modulus().get_mpz_t() ) )
+			return true;
+		r = 0;
+		return false;
+	}
+
+	bool is_zero( const value_t & a ) const
+	{
+		return a == 0;
+	}
+
+	bool equal( const value_t & a, const value_t & b ) const
+	{
+		return a == b;
+	}
+
+private:
+	modulus_context_t ctx;
+};
+
+//odd modulus below 2^(LIMBS*GMP_NUMB_BITS), elements are fixed arrays of limbs in Montgomery form
+//nothing is allocated, the products go through the mpn_* kernels
+template <size_t LIMBS> class mont_field_t
+{
+public:
+	struct value_t
+	{
+		mp_limb_t v[ LIMBS ];
+	};
+
+	mont_field_t( const mpz_class & modulus ): n_mpz( modulus )
+	{
+		load( n, modulus );
+
+		//-1/n mod 2^GMP_NUMB_BITS, n*n == 1 mod 8 and every Newton step doubles the correct bits
+		mp_limb_t inv = n.v[ 0 ];
+		for( int i = 0; i < 6; ++i )
+		{
+			inv *= 2 - n.v[ 0 ] * inv;
+		}
+		ninv = 0 - inv;
+
+		//R^2 mod n with R = 2^(LIMBS*GMP_NUMB_BITS), multiplying by it converts into Montgomery form
+		mpz_class r2;
+		mpz_setbit( r2.get_mpz_t(), 2 * LIMBS * GMP_NUMB_BITS );
+		mpz_fdiv_r( r2.get_mpz_t(), r2.get_mpz_t(), modulus.get_mpz_t() );
+		load( rr, r2 );
+	}
+
+	const mpz_class & modulus() const
+	{
+		return n_mpz;
+	}
+
+	void set( value_t & r, const mpz_class & a ) const
+	{
+		mpz_class t;
+		mpz_fdiv_r( t.get_mpz_t(), a.get_mpz_t(), n_mpz.get_mpz_t() );
+		value_t p;
+		load( p, t );
+		mul( r, p, rr );
+	}
+
+	mpz_class get( const value_t & a ) const
+	{
+		//a * 1 / R leaves the Montgomery form
+		mp_limb_t t[ 2 * LIMBS ] = { 0 };
+		for( size_t i = 0; i < LIMBS; ++i )
+		{
+			t[ i ] = a.v[ i ];
+		}
+		value_t p;
+		redc( p, t );
+
+		mpz_class r;
+		mpz_import( r.get_mpz_t(), LIMBS, -1, sizeof( mp_limb_t ), 0, 0, p.v );
+		return r;
+	}
+
+	void mul( value_t & r, const value_t & a, const value_t & b ) const
+	{
+		mp_limb_t t[ 2 * LIMBS ];
+		if( &a == &b )
+			mpn_sqr( t, a.v, LIMBS );
+		else
+			mpn_mul_n( t, a.v, b.v, LIMBS );
+		redc( r, t );
+	}
+
+	void add( value_t & r, const value_t & a, const value_t & b ) const
+	{
+		const mp_limb_t carry = mpn_add_n( r.v, a.v, b.v, LIMBS );
+		if( carry || mpn_cmp( r.v, n.v, LIMBS ) >= 0 )
+			mpn_sub_n( r.v, r.v, n.v, LIMBS );
+	}
+
+	void sub( value_t & r, const value_t & a, const value_t & b ) const
+	{
+		if( mpn_sub_n( r.v, a.v, b.v, LIMBS ) )
+			mpn_add_n( r.v, r.v, n.v, LIMBS );
+	}
+
+	//r = 1/a, false and r == 0 when a has no inverse
+	bool invert( value_t & r, const value_t & a ) const
+	{
+		mpz_class t = get( a );
+		const bool invertible = mpz_invert( t.get_mpz_t(), t.get_mpz_t(), n_mpz.get_mpz_t() ) != 0;
+		if( !invertible )
+			t = 0;
+		set( r, t );
+		return invertible;
+	}
+
+	bool is_zero( const value_t & a ) const
+	{
+		for( size_t i = 0; i < LIMBS; ++i )
+		{
+			if( a.v[ i ] )
+				return false;
+		}
+		return true;
+	}
+
+	bool equal( const value_t & a, const value_t & b ) const
+	{
+		return mpn_cmp( a.v, b.v, LIMBS ) == 0;
+	}
+
+private:
+	static void load( value_t & r, const mpz_class & a )
+	{
+		for( size_t i = 0; i < LIMBS; ++i )
+		{
+			r.v[ i ] = mpz_getlimbn( a.get_mpz_t(), i );
+		}
+	}
+
+	//r = t / R mod n, t < n*R is destroyed
+	//every step clears the lowest limb and keeps its carry in the cleared place, the carries are added at the end
+	void redc( value_t & r, mp_limb_t * t ) const
+	{
+		for( size_t i = 0; i < LIMBS; ++i )
+		{
+			const mp_limb_t q = t[ i ] * ninv;
+			t[ i ] = mpn_addmul_1( t + i, n.v, LIMBS, q );
+		}
+		const mp_limb_t carry = mpn_add_n( r.v, t + LIMBS, t, LIMBS );
+		if( carry || mpn_cmp( r.v, n.v, LIMBS ) >= 0 )
+			mpn_sub_n( r.v, r.v, n.v, LIMBS );
+	}
+
+	value_t n;
+	value_t rr;
+	mp_limb_t ninv;
+	mpz_class n_mpz;
+};
+
+#define FIELD_LIMBS( bits ) (((bits) + GMP_NUMB_BITS - 1) / GMP_NUMB_BITS)
+
+//calls job.run( field ) with the smallest fixed-width field that holds n, or with mpz_field_t when none does
+//Montgomery form needs an odd modulus
+template <typename J> typename J::result_t with_field( const mpz_class & n, J & job )
+{
+	if( n > 2 && mpz_odd_p( n.get_mpz_t() ) )
+	{
+		const size_t bits = mpz_sizeinbase( n.get_mpz_t(), 2 );
+		if( bits <= 256 )
+			return job.run( mont_field_t< FIELD_LIMBS( 256 ) >( n ) );
+		if( bits <= 384 )
+			return job.run( mont_field_t< FIELD_LIMBS( 384 ) >( n ) );
+		if( bits <= 521 )
+			return job.run( mont_field_t< FIELD_LIMBS( 521 ) >( n ) );
+		if( bits <= 1024 )
+			return job.run( mont_field_t< FIELD_LIMBS( 1024 ) >( n ) );
+		if( bits <= 2048 )
+			return job.run( mont_field_t< FIELD_LIMBS( 2048 ) >( n ) );
+		if( bits <= 4096 )
+			return job.run( mont_field_t< FIELD_LIMBS( 4096 ) >( n ) );
+	}
+	return job.run( mpz_field_t( n ) );
+}
+
+//Montgomery's trick: replaces every a[ i ] by its inverse with one inversion and 3 multiplications per element
+//zeros are skipped, when the product has no inverse (n is not prime) the elements are inverted one by one
+template <typename F> void batch_invert( const F & f, std::vector<typename F::value_t> & a )
+{
+	typedef typename F::value_t V;
+	std::vector<V> prefix( a.size() );
+	V acc;
+	f.set( acc, 1 );
+	for( size_t i = 0; i < a.size(); ++i )
+	{
+		prefix[ i ] = acc;
+		if( !f.is_zero( a[ i ] ) )
+			f.mul( acc, acc, a[ i ] );
+	}
+
+	V inv;
+	if( !f.invert( inv, acc ) )
+	{
+		for( size_t i = 0; i < a.size(); ++i )
+		{
+			if( !f.is_zero( a[ i ] ) )
+				f.invert( a[ i ], a[ i ] );
+		}
+		return;
+	}
+
+	//inv is 1/(a[ 0 ]*...*a[ i ]) when a[ i ] is visited
+	for( size_t i = a.size(); i-- > 0; )
+	{
+		if( f.is_zero( a[ i ] ) )
+			continue;
+		V t;
+		f.mul( t, inv, prefix[ i ] );
+		f.mul( inv, inv, a[ i ] );
+		a[ i ] = t;
+	}
+}
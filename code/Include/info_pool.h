@@ -0,0 +1,92 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#pragma once
+
+#include <mpir.h>
+#include <mpirxx.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//bigger numbers are not tested for primality, the test would hold a worker for minutes, as LAYOUT_MAX_PRIME_BITS
+#define INFO_MAX_PRIME_BITS 8192
+//bigger numbers get a placeholder instead of the decimal digits, the conversion would take seconds
+#define INFO_MAX_DEC_BITS (1 << 20)
+
+//the expensive chooser columns of one number
+struct number_columns_t
+{
+	unsigned int serial;
+	std::string dec;
+	std::string hex;
+	//false when the number was too big to be tested, prime is meaningless then
+	bool tested;
+	bool prime;
+};
+
+//formats numbers and tests them for primality on background threads, so the UI thread never waits for it
+//the owner tags every number with a serial and picks the finished columns up with collect()
+class info_pool_t
+{
+public:
+	//the strings are cut to max_text characters, nobody can read more in a chooser row
+	info_pool_t( size_t max_text, unsigned int threads = 0 );
+	~info_pool_t();
+
+	//the number is copied, the threads are started with the first job
+	void submit( unsigned int serial, const mpz_class & number );
+
+	//moves the finished columns into results, returns false when there were none
+	bool collect( std::vector<number_columns_t> & results );
+
+	//forgets the jobs nobody started yet and the results nobody collected
+	void clear();
+
+	//waits for the running jobs and joins the threads, must be called before the plugin is unloaded
+	void shutdown();
+
+private:
+	struct job_t
+	{
+		unsigned int serial;
+		mpz_class number;
+	};
+
+	void worker();
+	bool stopping();
+
+	size_t max_text;
+	unsigned int nthreads;
+	std::vector<std::thread> workers;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::deque<job_t> jobs;
+	std::vector<number_columns_t> finished;
+	bool stop;
+};
@@ -0,0 +1,63 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#pragma once
+
+#include <mpir.h>
+#include <mpirxx.h>
+#include <functional>
+#include <vector>
+
+//signals of one interpretation, from the strongest
+#define LAYOUT_KNOWN 8
+#define LAYOUT_PRIME 4
+#define LAYOUT_TOP_BIT 2
+#define LAYOUT_ODD 1
+
+//one of the word size / word endian / bignum endian combinations that mpz_import understands
+struct layout_t
+{
+	int word_size;
+	int word_endian;
+	int bignum_endian;
+};
+
+//a distinct number and every layout that reads it
+struct layout_guess_t
+{
+	mpz_class number;
+	std::vector<layout_t> layouts;
+	//LAYOUT_* bits
+	unsigned int signals;
+};
+
+//the primality test of bigger readings would take seconds each, they never get LAYOUT_PRIME
+#define LAYOUT_MAX_PRIME_BITS 8192
+
+//imports the bytes with word sizes 1, 2, 4 and 8 in every word and bignum endian, the equal numbers are merged
+//the guesses are sorted by their signals, the best first, known tells whether a number is already in the list
+//returns false when interrupted returned true between two readings, the guesses are incomplete then
+bool guess_layouts( const unsigned char * bytes, size_t size, const std::function<bool( const mpz_class & )> & known, std::vector<layout_guess_t> & guesses,
+	bool( *interrupted )(void) );
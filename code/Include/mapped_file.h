@@ -0,0 +1,63 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#pragma once
+
+#include <cstddef>
+
+//read only mapping of a whole file
+class mapped_file_t
+{
+public:
+	mapped_file_t();
+	~mapped_file_t();
+
+	//false when the file can not be opened or mapped, empty files can not be mapped either
+	bool open( const char * path );
+	void close();
+
+	const unsigned char * data() const
+	{
+		return view;
+	}
+
+	size_t size() const
+	{
+		return length;
+	}
+
+private:
+	mapped_file_t( const mapped_file_t & );
+	mapped_file_t & operator=( const mapped_file_t & );
+
+	const unsigned char * view;
+	size_t length;
+#ifdef __NT__
+	void * file;
+	void * mapping;
+#else
+	int file;
+#endif
+};
@@ -0,0 +1,94 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#pragma once
+
+#include <mpir.h>
+#include <mpirxx.h>
+#include <memory>
+#include <vector>
+
+//everything that depends only on the modulus, built once per modulus and shared by all exponentiations with it
+class modulus_context_t
+{
+public:
+	modulus_context_t( const mpz_class & modulus );
+
+	const mpz_class & modulus() const
+	{
+		return n;
+	}
+
+	size_t bits() const
+	{
+		return nbits;
+	}
+
+	//r = a*b mod n, a and b are already reduced
+	void mul( mpz_class & r, const mpz_class & a, const mpz_class & b ) const;
+
+	//r = a mod n in [0, n), also for negative a
+	void reduce( mpz_class & r, const mpz_class & a ) const;
+
+	//base^exp mod n for a base that is used only once
+	void pow( mpz_class & r, const mpz_class & base, const mpz_class & exp ) const;
+
+private:
+	mpz_class n;
+	size_t nbits;
+	//reciprocal of n, floor(2^(2*nbits) / n), for the Barrett reduction
+	mpz_class mu;
+};
+
+//the table of powm_table_t in the elements of one field from field.h, see modular.cpp
+class powm_kernel_t;
+
+//fixed-base window table for one base: base^(v << (w*i)) mod n for every window i and every digit v
+//base^exp then costs one multiplication per nonzero window of exp and no squarings
+//exponents longer than the modulus fall back to mpz_powm
+class powm_table_t
+{
+public:
+	//uses is the expected number of exponents, the window width is chosen from it
+	//when the table would not pay off it is not built and pow() is a plain mpz_powm
+	powm_table_t( const modulus_context_t & context, const mpz_class & base, size_t uses );
+	~powm_table_t();
+
+	void pow( mpz_class & r, const mpz_class & exp ) const;
+
+	mpz_class pow( const mpz_class & exp ) const
+	{
+		mpz_class r;
+		pow( r, exp );
+		return r;
+	}
+
+private:
+	const modulus_context_t & ctx;
+	mpz_class base;
+	unsigned int w;
+	size_t windows;
+	std::unique_ptr<powm_kernel_t> kernel;
+};
@@ -0,0 +1,101 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#pragma once
+
+#include <mpir.h>
+#include <mpirxx.h>
+#include <vector>
+#include <pro.h>
+#include "mapped_file.h"
+
+//binary number list, written and read on little endian machines
+//
+//	number_file_header_t
+//	number_file_entry_t[ count ]
+//	limbs of every number, 64 bit little endian words, least significant first, 8 byte aligned
+//
+//loading maps the file into memory, checks the whole index and imports the limbs straight from the mapping
+#define NUMBER_FILE_MAGIC "BIGNUMS"
+#define NUMBER_FILE_VERSION 1
+
+#pragma pack(push, 1)
+struct number_file_header_t
+{
+	char magic[ 8 ];
+	uint32 version;
+	uint32 count;
+	//md5 of the input file of the database the numbers were dumped from, all zeros when unknown
+	unsigned char input_md5[ 16 ];
+};
+
+struct number_file_entry_t
+{
+	//from the beginning of the file
+	uint64 offset;
+	uint64 limbs;
+	//-1, 0 or 1
+	int32 sign;
+	//how many times the number was dumped
+	uint32 hits;
+	//where the number was dumped from, all ones when it was not dumped from the database
+	uint64 address;
+};
+#pragma pack(pop)
+
+//addresses and hits run parallel to numbers
+bool save_number_file( const char * path, const std::vector<mpz_class> & numbers, const std::vector<ea_t> & addresses, const std::vector<uint32> & hits, const unsigned char input_md5[ 16 ] );
+
+//read only view of a number file, nothing is imported until get() asks for it
+class number_file_t
+{
+public:
+	number_file_t(): valid( false )
+	{
+	}
+
+	//false when the file can not be mapped or it is not a valid number file
+	bool open( const char * path );
+	void close();
+
+	//true when path starts with NUMBER_FILE_MAGIC, text lists are told apart by this
+	static bool is_number_file( const char * path );
+
+	const number_file_header_t & header() const
+	{
+		return *(const number_file_header_t *)file.data();
+	}
+
+	size_t size() const
+	{
+		return valid ? header().count : 0;
+	}
+
+	void get( size_t i, mpz_class & number, ea_t & address, uint32 & hits ) const;
+
+private:
+	mapped_file_t file;
+	bool valid;
+};
@@ -0,0 +1,43 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#pragma once
+
+#include <mpir.h>
+#include <mpirxx.h>
+#include <vector>
+#include <pro.h>
+
+//one bignum found in the database, preset is the index into presets that dumps it
+struct scan_hit_t
+{
+	ea_t address;
+	int preset;
+	mpz_class number;
+};
+
+//every segment is copied into a buffer once and the BER, gmp struct and text detectors run over it on all cores
+//the hits are sorted by address, returns false when the user interrupted the scan
+bool scan_database( std::vector<scan_hit_t> & hits );
@@ -0,0 +1,79 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//runs tasks 0..count-1 on all cores
+//every worker owns a queue of task indices, idle workers steal from the back of the others
+//the calling thread only waits and polls interrupted(), so it may be the IDA UI thread
+class task_pool_t
+{
+public:
+	typedef std::function<void( size_t task )> task_t;
+
+	task_pool_t( unsigned int threads = 0 );
+
+	//returns false when the run was interrupted, the findings of unfinished tasks are incomplete
+	bool run( size_t count, const task_t & task, bool( *interrupted )(void) );
+
+	//long tasks should check this and return early
+	bool stopped() const
+	{
+		return stop;
+	}
+
+	unsigned int threads() const
+	{
+		return nthreads;
+	}
+
+private:
+	struct queue_t
+	{
+		std::mutex lock;
+		std::deque<size_t> tasks;
+	};
+
+	bool pop( unsigned int worker, size_t & task );
+	void worker( unsigned int id, const task_t & task );
+
+	unsigned int nthreads;
+	std::vector< std::unique_ptr<queue_t> > queues;
+	std::atomic<bool> stop;
+	std::atomic<size_t> remaining;
+	std::mutex done_lock;
+	std::condition_variable done;
+	std::mutex error_lock;
+	std::exception_ptr error;
+};
@@ -0,0 +1,183 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#pragma once
+
+#include <mpir.h>
+#include <mpirxx.h>
+#include <cstdio>
+#include <vector>
+#include <pro.h>
+#include "mapped_file.h"
+
+//append only log of every dumped number, written on little endian machines
+//
+//	trace_file_header_t
+//	blocks, each one trace_block_header_t followed by count 8 byte values of every column in turn:
+//		sequence, time, address, call_site, limbs_end, sign
+//	and then the limbs of all numbers of the block, 64 bit little endian words, least significant first
+//
+//a block is written at once, after a crash only the last block can be torn and the reader stops before it
+#define TRACE_FILE_MAGIC "BNTRACE"
+#define TRACE_FILE_VERSION 1
+#define TRACE_BLOCK_MAGIC 0x4b4c4254
+#define TRACE_COLUMNS 6
+
+#pragma pack(push, 1)
+struct trace_file_header_t
+{
+	char magic[ 8 ];
+	uint32 version;
+	uint32 reserved;
+	//md5 of the input file of the database, all zeros when unknown
+	unsigned char input_md5[ 16 ];
+};
+
+struct trace_block_header_t
+{
+	uint32 magic;
+	uint32 count;
+	//of the whole block with this header
+	uint64 length;
+};
+#pragma pack(pop)
+
+//context of one hit
+struct trace_hit_t
+{
+	//counts every hit, also the hits of numbers that were already in the list
+	uint64 sequence;
+	//microseconds since 1970
+	uint64 time;
+	ea_t address;
+	//instruction pointer of the debugged thread, BADADDR outside of the debugger
+	ea_t call_site;
+};
+
+//collects the hits in columns and appends them as one block
+class trace_writer_t
+{
+public:
+	trace_writer_t(): file( NULL ), flushed_at( 0 )
+	{
+	}
+
+	~trace_writer_t()
+	{
+		close();
+	}
+
+	//appends to an existing trace, but only to a complete one of the same input file
+	bool open( const char * path, const unsigned char input_md5[ 16 ] );
+	void close();
+
+	bool is_open() const
+	{
+		return file != NULL;
+	}
+
+	//writes a block when the buffer is full
+	//both return false when writing failed, the trace is closed then
+	bool append( const trace_hit_t & hit, const mpz_class & number );
+	bool flush();
+
+	size_t buffered() const
+	{
+		return sequences.size();
+	}
+
+	//time of the newest hit that is on the disk
+	uint64 last_flush() const
+	{
+		return flushed_at;
+	}
+
+private:
+	trace_writer_t( const trace_writer_t & );
+	trace_writer_t & operator=( const trace_writer_t & );
+
+	FILE * file;
+	uint64 flushed_at;
+	std::vector<uint64> sequences;
+	std::vector<uint64> times;
+	std::vector<uint64> addresses;
+	std::vector<uint64> call_sites;
+	std::vector<uint64> limbs_ends;
+	std::vector<int64> signs;
+	std::vector<unsigned char> limbs;
+};
+
+//read only view of a trace, the blocks are found when it is opened and the numbers imported on demand
+class trace_reader_t
+{
+public:
+	trace_reader_t(): valid_end( 0 )
+	{
+	}
+
+	//false when the file can not be mapped or it does not start as a trace
+	bool open( const char * path );
+	void close();
+
+	//true when path starts with TRACE_FILE_MAGIC
+	static bool is_trace_file( const char * path );
+
+	const trace_file_header_t & header() const
+	{
+		return *(const trace_file_header_t *)file.data();
+	}
+
+	uint64 size() const
+	{
+		return blocks.empty() ? 0 : blocks.back().first + blocks.back().count;
+	}
+
+	//false when the file ends with a torn block, the hits before it are readable
+	bool complete() const
+	{
+		return valid_end == file.size();
+	}
+
+	//bytes up to the end of the last whole block
+	size_t valid_size() const
+	{
+		return valid_end;
+	}
+
+	//false when the entry is damaged
+	bool get( uint64 i, trace_hit_t & hit, mpz_class & number ) const;
+
+private:
+	struct block_t
+	{
+		uint64 first;
+		uint32 count;
+		size_t offset;
+	};
+
+	mapped_file_t file;
+	std::vector<block_t> blocks;
+	size_t valid_end;
+};
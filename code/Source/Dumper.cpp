@@ -28,6 +28,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <mpir.h>
 #include <mpirxx.h>
 #include <memory>
+#include <algorithm>
+#include <unordered_map>
+#include <map>
+#include <list>
+#include <exception>
 
 #include <ida.hpp>
 #include <idp.hpp>
@@ -38,14 +43,91 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <string>
 #include <sstream>
 #include "dumper.h"
+#include "decode.h"
+#include "scanner.h"
+#include "der.h"
+#include "info_pool.h"
+#include "number_file.h"
+#include "capture.h"
+#include "trace_log.h"
+#include "layout.h"
+#include <chrono>
 #include <expr.hpp>
 #include <diskio.hpp>
+#include <nalt.hpp>
+#include <dbg.hpp>
 #include "sdk_hacks.h"
 
 #define VERSION "1.1"
 
 number_list_t number_list;
 
+//what the chooser shows for number_list[ i ]
+//the strings and the primality test are expensive for big numbers, info_pool computes them in the background
+//and the chooser only copies them once they arrive
+struct number_info_t
+{
+	//where the number was found, BADADDR when it was not dumped from the database
+	ea_t address;
+	//serials grow with every push, so number_info stays sorted by them
+	unsigned int serial;
+	//false until the columns arrive from info_pool
+	bool ready;
+	number_columns_t columns;
+	int bits;
+	//how many times the number was pushed, the list keeps every value once
+	unsigned int hits;
+
+	number_info_t( ea_t ea = BADADDR, unsigned int serial = 0 ): address( ea ), serial( serial ), ready( false ), bits( 0 ), hits( 1 )
+	{
+	}
+};
+
+std::vector<number_info_t> number_info;
+static unsigned int next_serial = 0;
+//big_hash_t of every number in the list -> its serial, a breakpoint dumping the same key again only counts a hit
+static std::unordered_multimap<size_t, unsigned int> number_index;
+static info_pool_t info_pool( MAXSTR - 1 );
+
+//the list is repainted by refresh_timer_cb, so a burst of pushes and finished columns costs one refresh
+static bool list_dirty = false;
+static qtimer_t refresh_timer = NULL;
+#define REFRESH_INTERVAL 250
+
+//breakpoints calling capture() only copy bytes into this ring, refresh_timer_cb adds the decoded numbers
+#define CAPTURE_RING_SIZE (64 << 20)
+static capture_t capture( CAPTURE_RING_SIZE );
+
+//every number dumped by the IDC functions goes to the trace file while trace_start is in effect
+static trace_writer_t trace;
+static uint64 hit_sequence = 0;
+//a trace is at most this many microseconds behind
+#define TRACE_FLUSH_INTERVAL 1000000
+
+//since 1970
+static uint64 microseconds_now()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::system_clock::now().time_since_epoch() ).count();
+}
+
+//context of a dump that happens now
+static trace_hit_t new_hit( ea_t address )
+{
+	trace_hit_t hit;
+	hit.sequence = hit_sequence++;
+	hit.time = microseconds_now();
+	hit.address = address;
+	uval_t ip;
+	hit.call_site = get_process_state() == DSTATE_SUSP && get_ip_val( &ip ) ? ip : BADADDR;
+	return hit;
+}
+
+static void trace_number( const trace_hit_t & hit, const mpz_class & number )
+{
+	if( trace.is_open() && !trace.append( hit, number ) )
+		msg( "writing the trace failed, tracing stopped\n" );
+}
+
 qstrvec_t presets;
 qstrvec_t word_size;
 qstrvec_t endian;
@@ -71,6 +153,9 @@ static form_actions_t *g_fa;
 #define	ID_REFRESH 14
 #define	ID_GUESS_TYPE 15
 #define	ID_EXAMPLE 16
+#define	ID_SCAN 17
+#define	ID_DUMP_DER 18
+#define	ID_GUESS_LAYOUT 19
 //}
 
 
@@ -96,6 +181,9 @@ struct settings_t
 	size_t size()const;
 	bool read_settings( form_actions_t &fa );
 	bool dump( mpz_class &number );
+	bool capture( const trace_hit_t & hit );
+	bool layout_ok() const;
+	void decode( const unsigned char * bytes, mpz_class & number ) const;
 };
 
 void unregister_idc_functions();
@@ -103,6 +191,7 @@ void register_idc_functions();
 
 asize_t get_BER_int_offset( ea_t ea );
 asize_t get_BER_int_len( ea_t ea );
+static int dump_der( ea_t ea );
 
 typedef char reverse_table[ 256 ];
 
@@ -116,6 +205,9 @@ size_t alphabets_lengths[ nalphabets ];
 
 reverse_table reverse[ nalphabets ];
 
+//bit i is set for the bytes of alphabets[ i ], the text classifier ANDs them over the whole string
+unsigned char alphabet_masks[ 256 ];
+
 
 void update_table( const char * alphabet, reverse_table & table )
 {
@@ -142,6 +234,18 @@ void init_tables()
 			update_table( "0123456789abcdef", table );
 		}
 	}
+
+	for( size_t b = 0; b < 256; ++b )
+	{
+		alphabet_masks[ b ] = 0;
+		for( size_t i = 0; i < nalphabets; ++i )
+		{
+			if( (unsigned char)reverse[ i ][ b ] != 0xff )
+				alphabet_masks[ b ] |= 1 << i;
+		}
+	}
+	//base64 padding
+	alphabet_masks[ '=' ] |= 1 << (nalphabets - 1);
 }
 
 
@@ -251,19 +355,254 @@ static int idaapi btn_cb( TView *[], int )
 	return 0;
 }
 
-void push_number( const mpz_class & number, bool update = true )
+//position of the number with this serial in number_list, or number_list.size() when it is gone
+static size_t find_serial( unsigned int serial )
 {
+	number_info_t key( BADADDR, serial );
+	std::vector<number_info_t>::iterator info = std::lower_bound( number_info.begin(), number_info.end(), key,
+		[]( const number_info_t & a, const number_info_t & b ) { return a.serial < b.serial; } );
+	if( info == number_info.end() || info->serial != serial )
+		return number_list.size();
+	return info - number_info.begin();
+}
+
+//position of the number in number_list, or number_list.size() when it is not there
+static size_t find_number( const mpz_class & number, size_t hash )
+{
+	typedef std::unordered_multimap<size_t, unsigned int>::const_iterator index_iterator_t;
+	std::pair<index_iterator_t, index_iterator_t> same = number_index.equal_range( hash );
+	for( index_iterator_t i = same.first; i != same.second; ++i )
+	{
+		const size_t pos = find_serial( i->second );
+		if( pos < number_list.size() && number_list[ pos ] == number )
+			return pos;
+	}
+	return number_list.size();
+}
+
+//returns false when the number was already in the list, only its hit count grows then
+bool push_number( const mpz_class & number, bool update = true, ea_t address = BADADDR, unsigned int hits = 1 )
+{
+	const size_t hash = big_hash_t()( number );
+	const size_t pos = find_number( number, hash );
+	if( pos < number_list.size() )
+	{
+		number_info_t & info = number_info[ pos ];
+		info.hits += hits;
+		if( info.address == BADADDR )
+			info.address = address;
+		if( update )
+			list_dirty = true;
+		return false;
+	}
+
 	number_list.push_back( number );
+	number_info.push_back( number_info_t( address, next_serial ) );
+	number_info.back().bits = mpz_sizeinbase( number.get_mpz_t(), 2 );
+	number_info.back().hits = hits;
+	number_index.insert( std::make_pair( hash, next_serial ) );
+	info_pool.submit( next_serial++, number );
+
+	if( update )
+		list_dirty = true;
+	return true;
+}
+
+static void erase_number( size_t pos )
+{
+	typedef std::unordered_multimap<size_t, unsigned int>::iterator index_iterator_t;
+	std::pair<index_iterator_t, index_iterator_t> same = number_index.equal_range( big_hash_t()( number_list[ pos ] ) );
+	for( index_iterator_t i = same.first; i != same.second; ++i )
+	{
+		if( i->second == number_info[ pos ].serial )
+		{
+			number_index.erase( i );
+			break;
+		}
+	}
+	number_list.erase( number_list.begin() + pos );
+	number_info.erase( number_info.begin() + pos );
+}
 
-	if( update && g_fa )
+static void clear_numbers()
+{
+	number_list.clear();
+	number_info.clear();
+	number_index.clear();
+	info_pool.clear();
+}
+
+//runs on the UI thread, adds the captured numbers, stores the columns finished since the last tick
+//and repaints the list if anything changed
+static int idaapi refresh_timer_cb( void * )
+{
+	std::vector<captured_number_t> captured;
+	if( capture.collect( captured ) )
+	{
+		for( size_t i = 0; i < captured.size(); ++i )
+		{
+			trace_number( captured[ i ].hit, captured[ i ].number );
+			push_number( captured[ i ].number, false, captured[ i ].hit.address );
+		}
+		list_dirty = true;
+	}
+
+	if( trace.buffered() && microseconds_now() - trace.last_flush() >= TRACE_FLUSH_INTERVAL && !trace.flush() )
+		msg( "writing the trace failed, tracing stopped\n" );
+
+	std::vector<number_columns_t> results;
+	if( info_pool.collect( results ) )
+	{
+		for( size_t i = 0; i < results.size(); ++i )
+		{
+			const size_t pos = find_serial( results[ i ].serial );
+			//the number may have been deleted meanwhile
+			if( pos < number_list.size() )
+			{
+				number_info_t & info = number_info[ pos ];
+				info.columns.dec.swap( results[ i ].dec );
+				info.columns.hex.swap( results[ i ].hex );
+				info.columns.tested = results[ i ].tested;
+				info.columns.prime = results[ i ].prime;
+				info.ready = true;
+				list_dirty = true;
+			}
+		}
+	}
+	if( list_dirty && g_fa )
+	{
+		list_dirty = false;
 		g_fa->refresh_field( ID_BIGNUM_LIST );
+	}
+	return REFRESH_INTERVAL;
+}
+
+//defines the idc function name() returning the expression, false when it does not compile
+//'here' comes from idc.idc, which compiled lines may not see, so it is tried as a local variable too
+static bool compile_function( const char * name, const char * expression )
+{
+	char errbuf[ MAXSTR ] = { 0 };
+	qstring code;
+	code.sprnt( "static %s() { return (%s); }", name, expression );
+	if( CompileLine( code.c_str(), errbuf, sizeof( errbuf ) ) )
+		return true;
+	code.sprnt( "static %s() { auto here; here = ScreenEA(); return (%s); }", name, expression );
+	return CompileLine( code.c_str(), errbuf, sizeof( errbuf ) );
+}
+
+//defines the idc function name( here ) returning the expression, so it sees the same 'here' as calc_idc_expr
+//when 'here' is a macro the parameter does not compile, then only the texts without it are compiled
+static bool compile_expression( const char * name, const char * expression )
+{
+	char errbuf[ MAXSTR ] = { 0 };
+	qstring code;
+	code.sprnt( "static %s( here ) { return (%s); }", name, expression );
+	if( CompileLine( code.c_str(), errbuf, sizeof( errbuf ) ) )
+		return true;
+	if( strstr( expression, "here" ) )
+		return false;
+	code.sprnt( "static %s( ea ) { return (%s); }", name, expression );
+	return CompileLine( code.c_str(), errbuf, sizeof( errbuf ) );
+}
+
+static bool is_name_char( char c )
+{
+	return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_';
+}
+
+static bool is_operator_char( char c )
+{
+	return c != 0 && strchr( "+-*/%<>=!&|^~?:.", c ) != NULL;
+}
+
+//the whitespace outside of the string literals trimmed and collapsed, "Dword( here )" and "Dword(here)" differ only by it
+static std::string normalise_expr( const char * text )
+{
+	std::string normal;
+	char quote = 0;
+	bool space = false;
+	for( const char * p = text; *p; ++p )
+	{
+		const char c = *p;
+		if( quote )
+		{
+			normal += c;
+			if( c == '\\' && p[ 1 ] )
+				normal += *++p;
+			else if( c == quote )
+				quote = 0;
+			continue;
+		}
+		if( c == ' ' || c == '\t' || c == '\r' || c == '\n' )
+		{
+			space = true;
+			continue;
+		}
+		//a space is kept only where it separates two tokens, like in "a b" or "a - -b"
+		if( space && !normal.empty() && ((is_name_char( normal.back() ) && is_name_char( c )) || (is_operator_char( normal.back() ) && is_operator_char( c ))) )
+			normal += ' ';
+		space = false;
+		if( c == '"' || c == '\'' )
+			quote = c;
+		normal += c;
+	}
+	return normal;
+}
+
+//a compiled expression, the function is empty when the text does not compile
+struct compiled_expr_t
+{
+	std::string function;
+	unsigned int slot;
+	std::list<std::string>::iterator use;
+};
+
+//normalised expression text -> the idc function compiled from it
+//a preset dumped at many addresses parses its address and length expressions only once
+static std::map<std::string, compiled_expr_t> compiled_exprs;
+//the texts of compiled_exprs, the least recently used first
+static std::list<std::string> compiled_lru;
+#define MAX_COMPILED_EXPRS 1024
+
+//the compiled function or NULL when the text has to be interpreted by calc_idc_expr
+//names of the database are resolved only by calc_idc_expr, texts with them fail to compile and stay interpreted
+static const char * compiled_expr( const char * text )
+{
+	const std::string key = normalise_expr( text );
+	std::map<std::string, compiled_expr_t>::iterator known = compiled_exprs.find( key );
+	if( known != compiled_exprs.end() )
+	{
+		compiled_lru.splice( compiled_lru.end(), compiled_lru, known->second.use );
+		return known->second.function.empty() ? NULL : known->second.function.c_str();
+	}
+
+	unsigned int slot = (unsigned int)compiled_exprs.size();
+	if( compiled_exprs.size() >= MAX_COMPILED_EXPRS )
+	{
+		//the least recently used text gives up its function name, compiling it again replaces the old body
+		std::map<std::string, compiled_expr_t>::iterator oldest = compiled_exprs.find( compiled_lru.front() );
+		slot = oldest->second.slot;
+		compiled_exprs.erase( oldest );
+		compiled_lru.pop_front();
+	}
+
+	compiled_expr_t & compiled = compiled_exprs[ key ];
+	compiled.slot = slot;
+	compiled.use = compiled_lru.insert( compiled_lru.end(), key );
+	qstring name;
+	name.sprnt( "bignum_dumper_expr_%u", slot );
+	if( compile_expression( name.c_str(), key.c_str() ) )
+		compiled.function = name.c_str();
+	return compiled.function.empty() ? NULL : compiled.function.c_str();
 }
 
 static bool evalidc( char *ch, ea_t &adr, ea_t ea = get_screen_ea() )
 {
 	char wstr[ MAXSTR ] = { 0 };
 	idc_value_t v;
-	bool b = calc_idc_expr( ea, ch, &v, wstr, MAXSTR );
+	const char * function = compiled_expr( ch );
+	const idc_value_t here( (sval_t)ea );
+	bool b = function ? Run( function, 1, &here, &v, wstr, MAXSTR ) : calc_idc_expr( ea, ch, &v, wstr, MAXSTR );
 	if( !b )
 	{
 		warning( wstr );
@@ -498,20 +837,49 @@ bool settings_t::read_settings( form_actions_t &fa )
 	return true;
 }
 
-bool guess_template( form_actions_t &fa )
+//bit i of the result is set when every byte belongs to alphabets[ i ]
+//one pass for all alphabets, a table lookup and an AND per byte, 8 bytes between the checks for an early exit
+//SSE2 range compares of 16 bytes with movemask were measured no faster, the compares cost as much as the lookups
+unsigned int classify_text( const unsigned char * data, size_t size )
 {
-	char address_text[ MAXSTR ];
-	ea_t address;
+	unsigned int mask = (1 << nalphabets) - 1;
+	size_t i = 0;
+	for( ; i + 8 <= size && mask; i += 8 )
+	{
+		mask &= alphabet_masks[ data[ i ] ] & alphabet_masks[ data[ i + 1 ] ] & alphabet_masks[ data[ i + 2 ] ] & alphabet_masks[ data[ i + 3 ] ] &
+			alphabet_masks[ data[ i + 4 ] ] & alphabet_masks[ data[ i + 5 ] ] & alphabet_masks[ data[ i + 6 ] ] & alphabet_masks[ data[ i + 7 ] ];
+	}
+	for( ; i < size && mask; ++i )
+	{
+		mask &= alphabet_masks[ data[ i ] ];
+	}
+	return mask;
+}
 
-	if( !fa.get_ascii_value( ID_ADDRESS, address_text, MAXSTR ) )
-		return false;
+//a preset that fits the item, presets[ preset ], the best has the highest score
+struct template_guess_t
+{
+	int preset;
+	int score;
+};
 
-	if( !evalidc( address_text, address ) )
-		return false;
+static bool better_guess( const template_guess_t & a, const template_guess_t & b )
+{
+	return a.score > b.score;
+}
 
-	size_t to_probe = get_item_size( address );
+#define GUESS_GMP_PRESET 1
+#define GUESS_BER_PRESET 2
+#define GUESS_MIN_TEXT 5
+
+//all presets that fit the data at address, ranked
+//gmp struct before BER before the strings, the strings with the smaller alphabet first
+static void rank_templates( ea_t address, std::vector<template_guess_t> & ranked )
+{
+	ranked.clear();
 	if( !isEnabled( address ) )
-		return false;
+		return;
+
 	//check for gmp 32 bit bignum
 	{
 		uval_t max = get_long( address );
@@ -522,101 +890,365 @@ bool guess_template( form_actions_t &fa )
 			ea_t offset = get_long( address + 8 );
 			if( isEnabled( offset ) )
 			{
-				const int val = 1;//MAGIC value
-				fa.set_combobox_value( ID_PRESET, &val );
-				return true;
+				//limbs that are all inside the database are more convincing
+				const template_guess_t g = { GUESS_GMP_PRESET, len > 0 && isEnabled( offset + 4 * len - 1 ) ? 320 : 300 };
+				ranked.push_back( g );
 			}
 		}
 	}
 
 	//check for BER encoded number
 	{
-		if( get_BER_int_len( address ) != BADADDR )
+		const asize_t len = get_BER_int_len( address );
+		if( len != BADADDR )
 		{
-			const int val = 2;//MAGIC value
-			fa.set_combobox_value( ID_PRESET, &val );
-			return true;
+			const template_guess_t g = { GUESS_BER_PRESET, len > 0 && isEnabled( get_BER_int_offset( address ) + len - 1 ) ? 220 : 200 };
+			ranked.push_back( g );
 		}
 	}
 
-	if( to_probe < 5 )
+	const size_t to_probe = get_item_size( address );
+	if( to_probe >= GUESS_MIN_TEXT )
 	{
-		msg( "current item is too short" );
+		std::vector<unsigned char> buffer( to_probe );
+		if( get_many_bytes( address, &buffer[ 0 ], to_probe ) )
+		{
+			const unsigned char * end = (const unsigned char *)memchr( &buffer[ 0 ], 0, to_probe );
+			const size_t len = end ? end - &buffer[ 0 ] : to_probe;
+			const unsigned int mask = len ? classify_text( &buffer[ 0 ], len ) : 0;
+			//skip BER and GMP
+			for( size_t i = 2; i < arraysz( templates ); ++i )
+			{
+				if( mask & (1 << (i - 2)) )
+				{
+					//index to templates list .. must skip <none>
+					const template_guess_t g = { (int)i + 1, 100 - (int)i };
+					ranked.push_back( g );
+				}
+			}
+		}
+	}
+
+	std::stable_sort( ranked.begin(), ranked.end(), better_guess );
+}
+
+//all raw readings of the region at the address, words * word size bytes long, are ranked in the console
+//the best one is dumped and its layout is selected in the form
+//the readings are tested and printed on the UI thread, 512k bits is more than any key
+#define MAX_LAYOUT_REGION (1 << 16)
+
+static bool guess_layout( form_actions_t &fa )
+{
+	settings_t s;
+	if( !s.read_settings( fa ) )
+		return false;
+	const size_t size = s.size();
+	if( size == 0 || size > MAX_LAYOUT_REGION )
+	{
+		msg( "the region must have 1 to %d bytes\n", MAX_LAYOUT_REGION );
+		return false;
+	}
+
+	std::vector<unsigned char> bytes( size );
+	if( !get_many_bytes( s.address, &bytes[ 0 ], size ) )
 		return false;
+
+	std::vector<layout_guess_t> guesses;
+	show_wait_box( "guessing the layout..." );
+	const bool complete = guess_layouts( &bytes[ 0 ], size, []( const mpz_class & n ) { return find_number( n, big_hash_t()( n ) ) < number_list.size(); }, guesses, wasbreak );
+	hide_wait_box();
+	if( !complete || guesses.empty() )
+		return false;
+
+	msg( "layouts of %u bytes at %a, the best first:\n", (unsigned)size, s.address );
+	for( size_t g = 0; g < guesses.size(); ++g )
+	{
+		const layout_guess_t & guess = guesses[ g ];
+		msg( "%6u bits%s%s%s%s, read as", (unsigned)mpz_sizeinbase( guess.number.get_mpz_t(), 2 ),
+			guess.signals & LAYOUT_KNOWN ? ", in the list" : "",
+			guess.signals & LAYOUT_PRIME ? ", prime" : "",
+			guess.signals & LAYOUT_TOP_BIT ? ", top bit set" : "",
+			guess.signals & LAYOUT_ODD ? ", odd" : "" );
+		for( size_t l = 0; l < guess.layouts.size(); ++l )
+		{
+			const layout_t & layout = guess.layouts[ l ];
+			msg( " [%d %s %s]", layout.word_size, layout.word_endian == 1 ? "BE" : "LE", layout.bignum_endian == 1 ? "msw first" : "lsw first" );
+		}
+		msg( "\n" );
 	}
 
+	//the word size and the endians of the combo boxes, as read_settings decodes them
+	const layout_t & best = guesses[ 0 ].layouts[ 0 ];
+	int word_size_idx = 0;
+	while( (1 << word_size_idx) < best.word_size )
+	{
+		++word_size_idx;
+	}
+	int word_endian_idx = best.word_endian == 1 ? 1 : 0;
+	int bignum_endian_idx = best.bignum_endian == 1 ? 1 : 0;
+	int raw = 0;
+	char words[ 32 ];
+	qsnprintf( words, sizeof( words ), "%u", (unsigned)(size / best.word_size) );
+	fa.set_ascii_value( ID_WORDS, words );
+	fa.set_combobox_value( ID_WORD_SIZE, &word_size_idx );
+	fa.set_combobox_value( ID_WORD_ENDIAN, &word_endian_idx );
+	fa.set_combobox_value( ID_BIGNUM_ENDIAN, &bignum_endian_idx );
+	fa.set_combobox_value( ID_BASE, &raw );
+
+	push_number( guesses[ 0 ].number, true, s.address );
+	return true;
+}
 
-	std::unique_ptr<char> buffer = std::unique_ptr < char > {new char[ to_probe ]};
-	if( !buffer.get() )
+bool guess_template( form_actions_t &fa )
+{
+	char address_text[ MAXSTR ];
+	ea_t address;
+
+	if( !fa.get_ascii_value( ID_ADDRESS, address_text, MAXSTR ) )
 		return false;
 
-	if( !get_many_bytes( address, buffer.get(), to_probe ) )
+	if( !evalidc( address_text, address ) )
 		return false;
 
-	unsigned char * data = (unsigned char *)buffer.get();
-	const size_t len = strlen( buffer.get() );
-	size_t to_process = std::min( len, to_probe );
+	if( !isEnabled( address ) )
+		return false;
 
-	bool ok;
-	//skip BER and GMP
-	for( size_t i = 2; i < arraysz( templates ); ++i )
+	std::vector<template_guess_t> ranked;
+	rank_templates( address, ranked );
+	if( ranked.empty() )
 	{
-		const unsigned base = alphabets_lengths[ i - 2 ];
-		reverse_table & table = reverse[ i - 2 ];
+		msg( "no preset fits the current item\n" );
+		return true;
+	}
 
-		ok = false;
-		for( size_t j = 0; j < to_process; j++ )
+	fa.set_combobox_value( ID_PRESET, &ranked[ 0 ].preset );
+	if( ranked.size() > 1 )
+	{
+		msg( "other presets that fit:" );
+		for( size_t i = 1; i < ranked.size(); ++i )
 		{
-			const unsigned char b = data[ j ];
-			const unsigned char ch = table[ b ];
+			msg( " %s", presets[ ranked[ i ].preset ].c_str() );
+		}
+		msg( "\n" );
+	}
+	return true;
+}
+
+//the digits in alphabets[ base_idx - 1 ] up to the first other character, read from the end when bignum_endian == -1
+//the digits are collected and converted at once, number*base + ch for every digit would be quadratic
+void text_to_number( const unsigned char * text, size_t len, int base_idx, int bignum_endian, mpz_class & number )
+{
+	const unsigned base = alphabets_lengths[ base_idx - 1 ];
+	reverse_table & table = reverse[ base_idx - 1 ];
+
+	size_t start, stop, inc;
+	if( bignum_endian == 1 )
+	{
+		start = 0;
+		stop = len;
+		inc = 1;
+	}
+	else
+	{
+		start = len - 1;
+		stop = -1;
+		inc = -1;
+	}
+
+	number = 0;
+	std::vector<unsigned char> digits;
+	digits.reserve( len );
+	for( size_t i = start; i != stop; i += inc )
+	{
+		const unsigned char b = text[ i ];
+		const unsigned char ch = table[ b ];
 
-			if( ch == 0xff )
+		if( ch == 0xff )
+		{
+			if( (b == '=') && (base == 64) )
 			{
-				if( (b == '=') && (base == 64) )
-				{
-					goto end;//ugly ugly!
-				}
-				ok = false;
-				break;
+				append_digits( number, digits, base );
+				number >>= 2;
+				continue;
 			}
+			break;
+		}
+		digits.push_back( ch );
+	}
+	append_digits( number, digits, base );
+}
+
+//the dump is read in pages, so big numbers do not need one buffer for all of their bytes
+#define DUMP_PAGE 0x10000
+//sanity limit for a mistyped length expression
+#define MAX_DUMP_SIZE (64 << 20)
 
-		end:
-			if( j == to_process - 1 )
+//one imported page and its width in bits
+struct dump_part_t
+{
+	mpz_class value;
+	size_t bits;
+};
+
+//parts are least significant first, neighbours are joined pairwise so that every level costs linear time
+static void join_parts( std::vector<dump_part_t> & parts, mpz_class & number )
+{
+	if( parts.empty() )
+	{
+		number = 0;
+		return;
+	}
+	while( parts.size() > 1 )
+	{
+		size_t j = 0;
+		for( size_t i = 0; i < parts.size(); i += 2, ++j )
+		{
+			if( i + 1 == parts.size() )
 			{
-				ok = true;
+				parts[ j ].value.swap( parts[ i ].value );
+				parts[ j ].bits = parts[ i ].bits;
+				continue;
 			}
+			mpz_class & high = parts[ i + 1 ].value;
+			mpz_mul_2exp( high.get_mpz_t(), high.get_mpz_t(), parts[ i ].bits );
+			mpz_add( high.get_mpz_t(), high.get_mpz_t(), parts[ i ].value.get_mpz_t() );
+			parts[ j ].bits = parts[ i ].bits + parts[ i + 1 ].bits;
+			parts[ j ].value.swap( high );
 		}
-		if( ok )
+		parts.resize( j );
+	}
+	number.swap( parts[ 0 ].value );
+}
+
+//bytes up to the first \0 but at most max_size of them
+static bool read_text( ea_t ea, size_t max_size, std::vector<unsigned char> & text )
+{
+	text.clear();
+	std::vector<unsigned char> page( std::min( (size_t)DUMP_PAGE, max_size ) );
+	for( size_t offset = 0; offset < max_size; offset += DUMP_PAGE )
+	{
+		const size_t chunk = std::min( (size_t)DUMP_PAGE, max_size - offset );
+		if( !get_many_bytes( ea + offset, &page[ 0 ], chunk ) )
+			return false;
+		const unsigned char * end = (const unsigned char *)memchr( &page[ 0 ], 0, chunk );
+		if( end )
 		{
-			//fa.set_chooser_value();
-			//set_preset( fa, *templates[ i ] );
-			//index to templates list .. must skip <none>
-			const int val = i + 1;
-			fa.set_combobox_value( ID_PRESET, &val );
-			break;
+			text.insert( text.end(), page.begin(), page.begin() + (end - &page[ 0 ]) );
+			return true;
+		}
+		text.insert( text.end(), page.begin(), page.begin() + chunk );
+	}
+	return true;
+}
+
+//same as read_text, but into a buffer of max_size bytes
+static bool read_text_to( ea_t ea, size_t max_size, unsigned char * text, size_t & len )
+{
+	len = 0;
+	for( size_t offset = 0; offset < max_size; offset += DUMP_PAGE )
+	{
+		const size_t chunk = std::min( (size_t)DUMP_PAGE, max_size - offset );
+		if( !get_many_bytes( ea + offset, text + offset, chunk ) )
+			return false;
+		const unsigned char * end = (const unsigned char *)memchr( text + offset, 0, chunk );
+		if( end )
+		{
+			len = end - text;
+			return true;
 		}
+		len += chunk;
 	}
 	return true;
 }
 
+//the checks of dump() without the messages
+bool settings_t::layout_ok() const
+{
+	if( bignum_endian * bignum_endian != 1 )
+		return false;
+	if( base_idx == 0 )
+		return word_size > 0 && word_endian * word_endian <= 1;
+	return base_idx > 0 && base_idx <= nalphabets && word_size == 1;
+}
+
+//the number in size() bytes that were read already, text ends at the first \0
+void settings_t::decode( const unsigned char * bytes, mpz_class & number ) const
+{
+	const size_t to_dump = size();
+	if( base_idx == 0 )
+	{
+		mpz_import( number.get_mpz_t(), to_dump / word_size, bignum_endian, word_size, word_endian, 0, bytes );
+		return;
+	}
+	const unsigned char * end = (const unsigned char *)memchr( bytes, 0, to_dump );
+	text_to_number( bytes, end ? end - bytes : to_dump, base_idx, bignum_endian, number );
+}
+
+//copies the bytes dump() would read into the capture ring, the decoding is left to its thread
+//returns false when dump() has to do it here, because the settings are wrong, the number is too big or the ring is full
+bool settings_t::capture( const trace_hit_t & hit )
+{
+	const size_t to_dump = size();
+	if( to_dump == 0 || to_dump > CAPTURE_RING_SIZE / 4 || !layout_ok() )
+		return false;
+
+	capture_entry_t entry;
+	entry.address = address;
+	entry.call_site = hit.call_site;
+	entry.sequence = hit.sequence;
+	entry.time = hit.time;
+	entry.word_size = word_size;
+	entry.base_idx = base_idx;
+	entry.word_endian = word_endian;
+	entry.bignum_endian = bignum_endian;
+
+	unsigned char * bytes = ::capture.begin( entry, to_dump );
+	if( !bytes )
+		return false;
+
+	size_t len = to_dump;
+	if( base_idx == 0 )
+	{
+		if( !get_many_bytes( address, bytes, to_dump ) )
+			return false;
+	}
+	else if( !read_text_to( address, to_dump, bytes, len ) )
+		return false;
+
+	::capture.commit( len );
+	return true;
+}
+
 bool settings_t::dump( mpz_class &number )
 {
 	size_t to_dump = size();
-	if( to_dump > 1000 )
+	if( to_dump > MAX_DUMP_SIZE )
 	{
 		msg( "number is too big!\n" );
 		return false;
 	}
-	std::unique_ptr<char> buffer = std::unique_ptr < char > {new char[ to_dump ]};
-	if( !buffer.get() )
-		return false;
-	if( !get_many_bytes( address, buffer.get(), to_dump ) )
-		return false;
 	number = 0;
 
 	if( base_idx == 0 )
 	{
-		mpz_import( number.get_mpz_t(), length, bignum_endian, word_size, word_endian, 0, buffer.get() );
+		//every page holds whole words, with bignum_endian == 1 the first page is the most significant one
+		if( to_dump == 0 )
+			return true;
+		const size_t page = DUMP_PAGE - DUMP_PAGE % word_size;
+		std::vector<unsigned char> buffer( std::min( page, to_dump ) );
+		std::vector<dump_part_t> parts;
+		for( size_t offset = 0; offset < to_dump; offset += page )
+		{
+			const size_t chunk = std::min( page, to_dump - offset );
+			if( !get_many_bytes( address + offset, &buffer[ 0 ], chunk ) )
+				return false;
+			parts.push_back( dump_part_t() );
+			mpz_import( parts.back().value.get_mpz_t(), chunk / word_size, bignum_endian, word_size, word_endian, 0, &buffer[ 0 ] );
+			parts.back().bits = chunk * 8;
+		}
+		if( bignum_endian == 1 )
+			std::reverse( parts.begin(), parts.end() );
+		join_parts( parts, number );
 	}
 	else
 	{
@@ -631,51 +1263,19 @@ bool settings_t::dump( mpz_class &number )
 			msg( "Word size must be 1!" );
 			return false;
 		}
-		unsigned base = alphabets_lengths[ base_idx - 1 ];
+		if( bignum_endian != 1 && bignum_endian != -1 )
+		{
+			msg( "wrong bignum endian %d!\n", bignum_endian );
+			return false;
+		}
 
 		//word_size and is irrelevant
-		reverse_table & table = reverse[ base_idx - 1 ];
-		const size_t len = strlen( buffer.get() );
 		//sometimes there is final \0 byte in the string
 		//sometimes there is not
-		size_t to_process = std::min( len, to_dump );
-		size_t start, stop, inc;
-		switch( bignum_endian )
-		{
-			case 1:
-				start = 0;
-				stop = len;
-				inc = 1;
-				break;
-			case -1:
-				start = len - 1;
-				stop = -1;
-				inc = -1;
-				break;
-			default:
-				msg( "wrong bignum endian %d!\n", bignum_endian );
-				return false;
-		}
-
-		unsigned char * data = (unsigned char *)buffer.get();
-
-		number = 0;
-		for( int i = start; i != stop; i += inc )
-		{
-			const unsigned char b = data[ i ];
-			const unsigned char ch = table[ b ];
-
-			if( ch == 0xff )
-			{
-				if( (b == '=') && (base == 64) )
-				{
-					number >>= 2;
-					continue;
-				}
-				break;
-			}
-			number = number*base + ch;
-		}
+		std::vector<unsigned char> text;
+		if( !read_text( address, to_dump, text ) )
+			return false;
+		text_to_number( text.empty() ? NULL : &text[ 0 ], text.size(), base_idx, bignum_endian, number );
 	}
 
 	return true;
@@ -721,12 +1321,30 @@ bool set_preset( form_actions_t &fa, settings_t & settings )
 
 static bool saved = false;
 
+//the list goes to the binary number file, unless the name ends with .txt, then one decimal line per number is written
 static void save()
 {
-	char * path = askfile_c( 1, "numbers.txt", "where do you want to save it?" );
+	char * path = askfile_c( 1, "numbers.bnd", "where do you want to save it? (*.txt exports decimal text)" );
 	if( !path )
 		return;
 
+	const size_t len = qstrlen( path );
+	if( len < 4 || stricmp( path + len - 4, ".txt" ) != 0 )
+	{
+		std::vector<ea_t> addresses( number_info.size() );
+		std::vector<uint32> hits( number_info.size() );
+		for( size_t i = 0; i < number_info.size(); ++i )
+		{
+			addresses[ i ] = number_info[ i ].address;
+			hits[ i ] = number_info[ i ].hits;
+		}
+		uchar md5[ 16 ] = { 0 };
+		retrieve_input_file_md5( md5 );
+		if( !save_number_file( path, number_list, addresses, hits, md5 ) )
+			msg( "Could not write file %s!\n", path );
+		return;
+	}
+
 	FILE * f = fopenWT( path );
 	if( !f )
 	{
@@ -735,40 +1353,116 @@ static void save()
 	}
 	for each (const mpz_class & n in number_list)
 	{
-		std::stringstream ss;
-		ss << n << std::endl;
-
-		std::string s = ss.str();
+		std::string s = n.get_str( 10 );
+		s += '\n';
 		if( qfwrite( f, s.c_str(), s.length() ) != s.length() )
 			break;
 	}
 	qfclose( f );
 }
 
+//the addresses are kept only when the file was saved from a database of the same input file
+//every number is imported here, the chooser and the guesser read number_list directly, only the strings
+//and the primality test are left to the background
+static bool load_number_file( const char * path )
+{
+	number_file_t file;
+	if( !file.open( path ) )
+	{
+		msg( "%s is not a valid number file!\n", path );
+		return false;
+	}
+
+	uchar md5[ 16 ] = { 0 };
+	retrieve_input_file_md5( md5 );
+	const bool same_input = memcmp( md5, file.header().input_md5, sizeof( md5 ) ) == 0;
+	if( !same_input )
+		msg( "%s was saved from another input file, the addresses are dropped\n", path );
+
+	clear_numbers();
+	number_list.reserve( file.size() );
+	number_info.reserve( file.size() );
+	for( size_t i = 0; i < file.size(); ++i )
+	{
+		mpz_class number;
+		ea_t address;
+		uint32 hits;
+		file.get( i, number, address, hits );
+		push_number( number, false, same_input ? address : BADADDR, hits );
+	}
+	return true;
+}
+
+//every hit of the trace is pushed, so the list gets the unique numbers with their hit counts
+static bool load_trace_file( const char * path )
+{
+	trace_reader_t file;
+	if( !file.open( path ) )
+	{
+		msg( "%s is not a valid trace!\n", path );
+		return false;
+	}
+	if( !file.complete() )
+		msg( "%s ends with a damaged block, it is skipped\n", path );
+
+	uchar md5[ 16 ] = { 0 };
+	retrieve_input_file_md5( md5 );
+	const bool same_input = memcmp( md5, file.header().input_md5, sizeof( md5 ) ) == 0;
+	if( !same_input )
+		msg( "%s was traced in another input file, the addresses are dropped\n", path );
+
+	clear_numbers();
+	show_wait_box( "loading the trace" );
+	uint64 i = 0;
+	for( ; i < file.size(); ++i )
+	{
+		if( (i & 0xffff) == 0 && wasBreak() )
+			break;
+		trace_hit_t hit;
+		mpz_class number;
+		if( file.get( i, hit, number ) )
+			push_number( number, false, same_input ? hit.address : BADADDR );
+	}
+	hide_wait_box();
+	//the list keeps what was loaded, so it is still refreshed
+	if( i < file.size() )
+		msg( "loading was cancelled, only %" FMT_64 "u of %" FMT_64 "u hits of %s were imported\n", i, file.size(), path );
+	return true;
+}
+
 static bool load()
 {
-	char * path = askfile_c( 0, "*.txt", "Which file to load?" );
+	char * path = askfile_c( 0, "*.bnd;*.trace;*.txt", "Which file to load?" );
 	if( !path )
 		return false;
+	if( number_file_t::is_number_file( path ) )
+		return load_number_file( path );
+	if( trace_reader_t::is_trace_file( path ) )
+		return load_trace_file( path );
+
 	FILE * f = fopenRT( path );
 	if( !f )
 	{
 		msg( "Could not open file %s for reading!", path );
 		return false;
 	}
-	number_list.clear();
-	char line[ 2 * MAXSTR ] = { 0 };
-	while( qfgets( line, sizeof( line ), f ) != NULL )
+	clear_numbers();
+	//lines are read in pieces, so numbers of any length survive
+	std::string line;
+	char piece[ 2 * MAXSTR ] = { 0 };
+	bool more = true;
+	while( more )
 	{
-		try
-		{
-			mpz_class c( line );
+		more = qfgets( piece, sizeof( piece ), f ) != NULL;
+		if( more )
+			line += piece;
+		if( line.empty() || (more && line[ line.size() - 1 ] != '\n') )
+			continue;
+
+		mpz_class c;
+		if( mpz_set_str( c.get_mpz_t(), line.c_str(), 0 ) == 0 )
 			push_number( c, false );
-		}
-		catch( std::exception e )
-		{
-
-		}
+		line.clear();
 	}
 	qfclose( f );
 	return true;
@@ -879,7 +1573,7 @@ static int idaapi dumper_window_cb( int fid, form_actions_t &fa )
 			//load
 			if( load() )
 			{
-				fa.refresh_field( ID_BIGNUM_LIST );
+				list_dirty = true;
 			}
 			break;
 
@@ -889,6 +1583,12 @@ static int idaapi dumper_window_cb( int fid, form_actions_t &fa )
 			break;
 		}
 
+		case ID_GUESS_LAYOUT:
+		{
+			guess_layout( fa );
+			break;
+		}
+
 
 		case ID_REFRESH:
 			fa.refresh_field( ID_BIGNUM_LIST );
@@ -909,12 +1609,19 @@ static int idaapi dumper_window_cb( int fid, form_actions_t &fa )
 
 				try
 				{
-					std::string log = guess_relations( number_list );
+					//the wait box pumps the events, so the refresh timer may append captured numbers to number_list meanwhile
+					//the workers keep a reference to the list for the whole search, they get a copy
+					number_list_t snapshot = number_list;
+					std::string log = guess_relations( snapshot );
 					msg( "%s\n", log.c_str() );
 				}
+				catch( const std::exception & e )
+				{
+					msg( "guessing failed: %s\n", e.what() );
+				}
 				catch( ... )
 				{
-
+					msg( "guessing failed with an unknown exception\n" );
 				}
 
 				hide_wait_box();
@@ -929,7 +1636,23 @@ static int idaapi dumper_window_cb( int fid, form_actions_t &fa )
 			mpz_class number;
 			if( !s.dump( number ) )
 				break;
-			push_number( number );
+			push_number( number, true, s.address );
+			break;
+		}
+
+		case ID_DUMP_DER:
+		{
+			char address_text[ MAXSTR ];
+			ea_t address;
+			if( !fa.get_ascii_value( ID_ADDRESS, address_text, MAXSTR ) )
+				break;
+			if( !evalidc( address_text, address ) )
+				break;
+			const int count = dump_der( address );
+			if( count < 0 )
+				msg( "no DER structure at %a\n", address );
+			else
+				msg( "%d integers dumped\n", count );
 			break;
 		}
 
@@ -938,7 +1661,43 @@ static int idaapi dumper_window_cb( int fid, form_actions_t &fa )
 			settings_t s;
 			if( !s.read_settings( fa ) )
 				break;
-			msg( "code: dump( %s, %s, %d, %d, %d, %d )\n", s.address_text, s.length_text, s.word_size, s.base_idx, s.word_endian, s.bignum_endian );
+			qstring call;
+			call.sprnt( "dump( %s, %s, %d, %d, %d, %d )", s.address_text, s.length_text, s.word_size, s.base_idx, s.word_endian, s.bignum_endian );
+			msg( "code: %s\n", call.c_str() );
+
+			//the same call compiled once, a breakpoint condition calling it does not parse the expressions on every hit
+			static unsigned int generated = 0;
+			qstring name;
+			name.sprnt( "bignum_dump_%u", ++generated );
+			if( compile_function( name.c_str(), call.c_str() ) )
+				msg( "compiled as: %s()\n", name.c_str() );
+			break;
+		}
+		case ID_SCAN:
+		{
+			show_wait_box( "scanning the database for bignums..." );
+			std::vector<scan_hit_t> hits;
+			bool complete = false;
+			try
+			{
+				complete = scan_database( hits );
+			}
+			catch( const std::exception & e )
+			{
+				msg( "scanning failed: %s\n", e.what() );
+			}
+			catch( ... )
+			{
+				msg( "scanning failed with an unknown exception\n" );
+			}
+			hide_wait_box();
+
+			for( size_t i = 0; i < hits.size(); ++i )
+			{
+				push_number( hits[ i ].number, false, hits[ i ].address );
+			}
+			msg( "%u bignums found%s\n", (unsigned)hits.size(), complete ? "" : ", the scan was interrupted" );
+			list_dirty = true;
 			break;
 		}
 		case ID_EXAMPLE:
@@ -985,6 +1744,11 @@ static int idaapi gen_cb( TView *[], int )
 	return 0;
 }
 
+static int idaapi scan_cb( TView *[], int )
+{
+	return 0;
+}
+
 static int idaapi refresh_cb( TView *[], int )
 {
 	//msg( "Dump button has been pressed -> " );
@@ -1002,6 +1766,8 @@ static void idaapi getl( void *, uint32 n, char * const *arrptr )
 		qstrncpy( arrptr[ 1 ], "hex", MAXSTR );
 		qstrncpy( arrptr[ 2 ], "prime?", MAXSTR );
 		qstrncpy( arrptr[ 3 ], "bits", MAXSTR );
+		qstrncpy( arrptr[ 4 ], "hits", MAXSTR );
+		qstrncpy( arrptr[ 5 ], "address", MAXSTR );
 	}
 	else
 	{
@@ -1009,29 +1775,27 @@ static void idaapi getl( void *, uint32 n, char * const *arrptr )
 
 		if( pos < number_list.size() )
 		{
-			std::string s;
-			std::stringstream ss;
-			mpz_class & number = number_list[ pos ];
-
-			ss << number;
-			s = ss.str();
-
-			qstrncpy( arrptr[ 0 ], s.c_str(), MAXSTR );
-
-			ss.str( std::string() );
-
-			ss << std::hex << number;
-
-			s = ss.str();
-			qstrncpy( arrptr[ 1 ], s.c_str(), MAXSTR );
+			const number_info_t & info = number_info[ pos ];
 
-			//mpz_likely_prime_p();
-			qstrncpy( arrptr[ 2 ], mpz_probab_prime_p( number.get_mpz_t(), 8 ) ? "yes" : "no", MAXSTR );
+			if( info.ready )
+			{
+				qstrncpy( arrptr[ 0 ], info.columns.dec.c_str(), MAXSTR );
+				qstrncpy( arrptr[ 1 ], info.columns.hex.c_str(), MAXSTR );
+				qstrncpy( arrptr[ 2 ], !info.columns.tested ? "?" : info.columns.prime ? "yes" : "no", MAXSTR );
+			}
+			else
+			{
+				qstrncpy( arrptr[ 0 ], "...", MAXSTR );
+				qstrncpy( arrptr[ 1 ], "...", MAXSTR );
+				qstrncpy( arrptr[ 2 ], "?", MAXSTR );
+			}
+			qsnprintf( arrptr[ 3 ], MAXSTR, "%d", info.bits );
+			qsnprintf( arrptr[ 4 ], MAXSTR, "%u", info.hits );
 
-			int bits = mpz_sizeinbase( number.get_mpz_t(), 2 );
-			qstring qbits;
-			qbits.cat_sprnt( "%d", bits );
-			qstrncpy( arrptr[ 3 ], qbits.c_str(), MAXSTR );
+			if( info.address != BADADDR )
+				qsnprintf( arrptr[ 5 ], MAXSTR, "%a", info.address );
+			else
+				qstrncpy( arrptr[ 5 ], "", MAXSTR );
 		}
 		else
 		{
@@ -1046,9 +1810,8 @@ static uint32 idaapi del( void *obj, uint32 n )
 {
 	try// with std::advance one can never be too carefull
 	{
-		number_list_t::iterator i = number_list.begin();
-		std::advance( i, n - 1 );
-		number_list.erase( i );
+		if( n - 1 < number_list.size() )
+			erase_number( n - 1 );
 	}
 	catch( ... )
 	{
@@ -1098,17 +1861,20 @@ static void open_dumper_form( int options = 0 )
 		"<preset:" CMD_DROPDOWN( ID_PRESET ) ":0::::>\n"     // preset
 		"<#Address of the bignum in memory. You can use and idc expression here.#address:" CMD_ASCII( ID_ADDRESS ) ":::::> "     // address
 		"<#Tries to guess template of bignum at this address. Works only with textual types#guess template:" CMD_BUTTON( ID_GUESS_TYPE ) ":::::>\n" // guess type button
-		"<#Number of words in the bignum. You can use and idc expression here.#words:" CMD_ASCII( ID_WORDS ) ":::::>\n" // length of bignum (in words)
+		"<#Number of words in the bignum. You can use and idc expression here.#words:" CMD_ASCII( ID_WORDS ) ":::::> " // length of bignum (in words)
+		"<#Reads words * word size raw bytes and tries all word sizes and endians, the best reading is dumped and selected.#guess layout:" CMD_BUTTON( ID_GUESS_LAYOUT ) ":::::>\n" // guess layout button
 		"<#Size of the word in bignum.#word size:" CMD_DROPDOWN( ID_WORD_SIZE ) ":0::::>\n" // size of one bignum word
 		"<#filter to use for dumping.#base:" CMD_DROPDOWN( ID_BASE ) ":0::::>\n" // base
 		"<#Endianess of every singe word in bignum.#word endian:" CMD_DROPDOWN( ID_WORD_ENDIAN ) ":0::::>\n" // word endian
 		"<#Endianess of the whole number.#bignum endian:" CMD_DROPDOWN( ID_BIGNUM_ENDIAN ) ":0::::>\n" // bignum endian
 		"\nexample: " CMD_LABELA( ID_EXAMPLE ) "\n" // example
 		"<#Dumps bignum from memory into bignums list.#dump:" CMD_BUTTON( ID_DUMP ) ":::::>" // dump button
+		"<#Dumps all integers of the DER structure at the address, e.g. all fields of a key.#dump DER:" CMD_BUTTON( ID_DUMP_DER ) ":::::>" // dump der button
 		"<#Tries to guess formulas for current list of bignums.#guess:" CMD_BUTTON( ID_GUESS ) ":::::>" // guess button
 		"<#Save current bignum list to text file.#save:" CMD_BUTTON( ID_SAVE ) ":::::>" // save button
 		"<#Load bignums from text file.#load:" CMD_BUTTON( ID_LOAD ) ":::::>" // load button
 		"<#This will write an idc command to dump bignum with current configuration to console. Stick it this into breakpoint or so.#idc expression:" CMD_BUTTON( ID_GEN_IDC ) ":::::>" // gen idc button
+		"<#Scans all segments for BER integers, gmp structs and numeric strings and adds them to the list.#scan database:" CMD_BUTTON( ID_SCAN ) ":::::>" // scan button
 		//		"<#If you use dump idc command the bignum list is not automatically refreshed. To fix it uset this button.#refresh list:" CMD_BUTTON(ID_REFRESH) ":::::>\n" // manual refresh
 		"<numbers:" CMD_CHOOSE( ID_BIGNUM_LIST ) ":::::>\n" // bignum list
 		;
@@ -1116,11 +1882,11 @@ static void open_dumper_form( int options = 0 )
 	// structure for chooser list view
 	chooser_info_t chi = { 0 };
 	chi.cb = sizeof( chooser_info_t );
-	chi.columns = 4;
+	chi.columns = 6;
 	chi.getl = getl;
 	chi.sizer = sizer;
 	chi.title = CHOOSER_NOSTATUSBAR;
-	static const int widths[] = { 30, 30, 4, 4 };
+	static const int widths[] = { 30, 30, 4, 4, 4, 10 };
 	chi.widths = widths;
 	chi.width = 140;
 	chi.icon = -1;
@@ -1142,16 +1908,19 @@ static void open_dumper_form( int options = 0 )
 		addr,//default value for address
 		dump_cb,//guess type button
 		len, // default value for length
+		dump_cb,//guess layout button
 		&word_size, &selection,
 		&basis, &selection,
 		&endian, &selection,
 		&endian, &selection,
 		"1 = [01]",
 		dump_cb,
+		dump_cb,
 		guess_cb,
 		save_cb,
 		load_cb,
 		gen_cb,
+		scan_cb,
 		//		refresh_cb,
 		&chi, &selected
 		);
@@ -1179,6 +1948,8 @@ static int idaapi init( void )
 	initme();
 
 	register_idc_functions();
+	//captured numbers are added even while the form is closed
+	refresh_timer = register_timer( REFRESH_INTERVAL, refresh_timer_cb, NULL );
 
 	addon_info_t addon;
 	addon.id = "milan.bohacek.bignum.dumper";
@@ -1197,6 +1968,14 @@ static int idaapi init( void )
 static void idaapi term( void )
 {
 	unregister_idc_functions();
+	if( refresh_timer )
+	{
+		unregister_timer( refresh_timer );
+		refresh_timer = NULL;
+	}
+	capture.shutdown();
+	trace.close();
+	info_pool.shutdown();
 }
 
 //--------------------------------------------------------------------------
@@ -1218,60 +1997,139 @@ bool wasbreak( void )
 	return wasBreak();
 }
 
+//the tag and the length of the TLV at ea, read at once
+static bool read_der_header( ea_t ea, der_tlv_t & tlv )
+{
+	unsigned char header[ 2 + sizeof( size_t ) ];
+	if( !get_many_bytes( ea, header, 2 ) )
+		return false;
+	size_t size = 2;
+	if( header[ 1 ] & 0x80 )
+	{
+		size += header[ 1 ] & 0x7f;
+		if( size > sizeof( header ) || !get_many_bytes( ea, header, size ) )
+			return false;
+	}
+	return der_read_header( header, size, 0, tlv );
+}
+
 // ea -> pointer to the beginning of BER encoded INTEGER
 static asize_t get_BER_int_len( ea_t ea )
 {
-	if( !isEnabled( ea ) )
+	der_tlv_t tlv;
+	if( !read_der_header( ea, tlv ) || tlv.tag != DER_INTEGER )
 		return BADADDR;
-	//skip tag
-	uchar t = get_byte( ea );
-	if( t != 2 )
+	return tlv.length;
+}
+
+// ea -> pointer to the beginning of BER encoded INTEGER
+static asize_t get_BER_int_offset( ea_t ea )
+{
+	der_tlv_t tlv;
+	if( !read_der_header( ea, tlv ) || tlv.tag != DER_INTEGER )
 		return BADADDR;
-	ea += 1;
-	asize_t len = 0;
-	uchar l;
+	return ea + tlv.offset;
+}
 
-	l = get_byte( ea++ );
-	if( (l & 0x80) == 0 )
-		return l;
+//reads the whole DER structure at ea at once and pushes all of its INTEGERs, returns their count or -1
+//a SEQUENCE of a key gives all of its fields, e.g. the nine of RSAPrivateKey or p, q, g of DSA parameters
+static int dump_der( ea_t ea )
+{
+	der_tlv_t tlv;
+	if( !read_der_header( ea, tlv ) )
+		return -1;
+	const size_t size = tlv.offset + tlv.length;
+	if( tlv.length > MAX_DUMP_SIZE )
+	{
+		msg( "number is too big!\n" );
+		return -1;
+	}
 
-	l = l & 0x7f;
-	for( asize_t j = 0; j < l; ++j )
+	std::vector<unsigned char> buffer( size );
+	if( !get_many_bytes( ea, &buffer[ 0 ], size ) )
+		return -1;
+
+	std::vector<der_tlv_t> integers;
+	if( !der_integers( &buffer[ 0 ], size, integers ) )
+		return -1;
+
+	for( size_t i = 0; i < integers.size(); ++i )
 	{
-		uchar d = get_byte( ea++ );
-		len = (len << 8) | d;
+		mpz_class number;
+		if( integers[ i ].length )
+			mpz_import( number.get_mpz_t(), integers[ i ].length, 1, 1, 1, 0, &buffer[ integers[ i ].offset ] );
+		trace_number( new_hit( ea + integers[ i ].position ), number );
+		push_number( number, false, ea + integers[ i ].position );
 	}
-	return len;
+	list_dirty = true;
+	return integers.size();
 }
 
-// ea -> pointer to the beginning of BER encoded INTEGER
-static asize_t get_BER_int_offset( ea_t ea )
+//dumps count numbers of the same layout, the i-th one at start + i * stride, and returns how many were dumped or -1
+//the whole table is read at once and the list is refreshed once, a table of 256 byte moduli takes one call
+static int dump_array( const settings_t & s, ea_t start, asize_t stride, size_t count )
 {
-	if( !isEnabled( ea ) )
-		return BADADDR;
-	//skip tag
-	uchar t = get_byte( ea );
-	if( t != 2 )
-		return BADADDR;
-	++ea;
-	asize_t len = 0;
-	uchar l = get_byte( ea++ );
+	const size_t element = s.size();
+	if( count == 0 )
+		return 0;
+	if( element == 0 || !s.layout_ok() )
+	{
+		msg( "wrong layout!\n" );
+		return -1;
+	}
+	if( element > MAX_DUMP_SIZE || stride == 0 || (count - 1) > (MAX_DUMP_SIZE - element) / stride )
+	{
+		msg( "the table is too big!\n" );
+		return -1;
+	}
 
-	if( (l & 0x80) == 0 )
-		return ea;
+	const size_t span = (count - 1) * stride + element;
+	std::vector<unsigned char> table( span );
+	for( size_t offset = 0; offset < span; offset += DUMP_PAGE )
+	{
+		const size_t chunk = std::min( (size_t)DUMP_PAGE, span - offset );
+		if( !get_many_bytes( start + offset, &table[ offset ], chunk ) )
+		{
+			msg( "could not read %a\n", start + offset );
+			return -1;
+		}
+	}
 
-	l = l & 0x7f;
-	return ea + l;
+	for( size_t i = 0; i < count; ++i )
+	{
+		mpz_class number;
+		s.decode( &table[ i * stride ], number );
+		trace_number( new_hit( start + i * stride ), number );
+		push_number( number, false, start + i * stride );
+	}
+	list_dirty = true;
+	return count;
 }
 
 static const char dump_idc_args[] = { VT_LONG, VT_LONG, VT_LONG, VT_LONG, VT_LONG, VT_LONG, 0 };
 
 static error_t idaapi dump_idc( idc_value_t *argv, idc_value_t *res )
 {
-	msg( "dump_idc is called with arg0=%" FMT_EA "x\n", argv[ 0 ].num );
-	//argv[ 0 ].num
-
+	settings_t s;
+	s.address = argv[ 0 ].num;
+	s.length = argv[ 1 ].num;
+	s.word_size = argv[ 2 ].num;
+	s.base_idx = argv[ 3 ].num;
+	s.word_endian = argv[ 4 ].num;
+	s.bignum_endian = argv[ 5 ].num;
+	mpz_class number;
+	if( s.dump( number ) )
+	{
+		trace_number( new_hit( s.address ), number );
+		push_number( number, true, s.address );
+	}
+	return eOk;
+}
 
+//same arguments as dump, for breakpoints hit millions of times
+//returns 1 when the bytes went to the capture ring, 0 when the number was dumped at once and -1 when it could not be dumped
+static error_t idaapi capture_idc( idc_value_t *argv, idc_value_t *res )
+{
 	settings_t s;
 	s.address = argv[ 0 ].num;
 	s.length = argv[ 1 ].num;
@@ -1279,9 +2137,68 @@ static error_t idaapi dump_idc( idc_value_t *argv, idc_value_t *res )
 	s.base_idx = argv[ 3 ].num;
 	s.word_endian = argv[ 4 ].num;
 	s.bignum_endian = argv[ 5 ].num;
+	const trace_hit_t hit = new_hit( s.address );
+	if( s.capture( hit ) )
+	{
+		res->set_long( 1 );
+		return eOk;
+	}
 	mpz_class number;
 	if( s.dump( number ) )
-		push_number( number );
+	{
+		trace_number( hit, number );
+		push_number( number, true, s.address );
+		res->set_long( 0 );
+	}
+	else
+		res->set_long( -1 );
+	return eOk;
+}
+
+static const char trace_start_idc_args[] = { VT_STR2, 0 };
+
+//starts writing every dumped number to the trace file, an existing trace is continued
+static error_t idaapi trace_start_idc( idc_value_t *argv, idc_value_t *res )
+{
+	uchar md5[ 16 ] = { 0 };
+	retrieve_input_file_md5( md5 );
+	const bool ok = trace.open( argv[ 0 ].c_str(), md5 );
+	if( !ok )
+		msg( "Could not trace to %s, it is not an empty file or a complete trace of this database!\n", argv[ 0 ].c_str() );
+	res->set_long( ok ? 1 : 0 );
+	return eOk;
+}
+
+static const char trace_stop_idc_args[] = { 0 };
+
+static error_t idaapi trace_stop_idc( idc_value_t *argv, idc_value_t *res )
+{
+	trace.close();
+	res->set_long( 0 );
+	return eOk;
+}
+
+static const char dump_array_idc_args[] = { VT_LONG, VT_LONG, VT_LONG, VT_LONG, VT_LONG, VT_LONG, VT_LONG, VT_LONG, 0 };
+
+//dump_array( start, stride, count, length, word_size, base_idx, word_endian, bignum_endian )
+static error_t idaapi dump_array_idc( idc_value_t *argv, idc_value_t *res )
+{
+	settings_t s;
+	s.address = argv[ 0 ].num;
+	s.length = argv[ 3 ].num;
+	s.word_size = argv[ 4 ].num;
+	s.base_idx = argv[ 5 ].num;
+	s.word_endian = argv[ 6 ].num;
+	s.bignum_endian = argv[ 7 ].num;
+	res->set_long( dump_array( s, s.address, argv[ 1 ].num, argv[ 2 ].num ) );
+	return eOk;
+}
+
+static const char dump_der_idc_args[] = { VT_LONG, 0 };
+
+static error_t idaapi dump_der_idc( idc_value_t *argv, idc_value_t *res )
+{
+	res->set_long( dump_der( argv[ 0 ].num ) );
 	return eOk;
 }
 
@@ -1310,6 +2227,11 @@ static error_t idaapi idc_BER_offset( idc_value_t *argv, idc_value_t *res )
 void unregister_idc_functions()
 {
 	set_idc_func_ex( "dump", NULL, NULL, 0 );
+	set_idc_func_ex( "capture", NULL, NULL, 0 );
+	set_idc_func_ex( "trace_start", NULL, NULL, 0 );
+	set_idc_func_ex( "trace_stop", NULL, NULL, 0 );
+	set_idc_func_ex( "dump_der", NULL, NULL, 0 );
+	set_idc_func_ex( "dump_array", NULL, NULL, 0 );
 	set_idc_func_ex( "BER_int_length", NULL, NULL, 0 );
 	set_idc_func_ex( "BER_int_offset", NULL, NULL, 0 );
 }
@@ -1317,6 +2239,11 @@ void unregister_idc_functions()
 void register_idc_functions()
 {
 	set_idc_func_ex( "dump", dump_idc, dump_idc_args, EXTFUN_BASE );
+	set_idc_func_ex( "capture", capture_idc, dump_idc_args, EXTFUN_BASE );
+	set_idc_func_ex( "trace_start", trace_start_idc, trace_start_idc_args, EXTFUN_BASE );
+	set_idc_func_ex( "trace_stop", trace_stop_idc, trace_stop_idc_args, EXTFUN_BASE );
+	set_idc_func_ex( "dump_der", dump_der_idc, dump_der_idc_args, EXTFUN_BASE );
+	set_idc_func_ex( "dump_array", dump_array_idc, dump_array_idc_args, EXTFUN_BASE );
 	set_idc_func_ex( "BER_int_length", idc_BER_length, idc_BER_length_args, EXTFUN_BASE );
 	set_idc_func_ex( "BER_int_offset", idc_BER_offset, idc_BER_offset_args, EXTFUN_BASE );
 }
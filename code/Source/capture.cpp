@@ -0,0 +1,187 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#include <chrono>
+#include <cstring>
+#include "capture.h"
+#include "dumper.h"
+
+#define RECORD_ALIGN 8
+//length prefix of every record
+#define RECORD_HEADER 8
+#define WRAP_MARKER ((uint64)-1)
+//the decoder sleeps this long when the ring is empty
+#define DECODER_IDLE 5
+
+static size_t record_length( size_t size )
+{
+	return (RECORD_HEADER + size + RECORD_ALIGN - 1) & ~(size_t)(RECORD_ALIGN - 1);
+}
+
+capture_ring_t::capture_ring_t( size_t capacity ): buffer( capacity & ~(size_t)(RECORD_ALIGN - 1) ), head( 0 ), tail( 0 ), write_at( 0 ), read_at( 0 ), read_size( 0 )
+{
+}
+
+unsigned char * capture_ring_t::begin_write( size_t max_size )
+{
+	const size_t capacity = buffer.size();
+	const size_t length = record_length( max_size );
+	const size_t h = head.load( std::memory_order_relaxed );
+	const size_t t = tail.load( std::memory_order_acquire );
+
+	//head == tail means empty, so the head must never catch up with the tail
+	if( h >= t )
+	{
+		if( length < capacity - h || (length == capacity - h && t != 0) )
+			write_at = h;
+		else if( length < t )
+			write_at = 0;
+		else
+			return NULL;
+	}
+	else if( length < t - h )
+		write_at = h;
+	else
+		return NULL;
+
+	return &buffer[ write_at + RECORD_HEADER ];
+}
+
+void capture_ring_t::end_write( size_t size )
+{
+	const size_t h = head.load( std::memory_order_relaxed );
+	//the reader jumps to the beginning when it finds the marker
+	if( write_at != h )
+		*(uint64 *)&buffer[ h ] = WRAP_MARKER;
+	*(uint64 *)&buffer[ write_at ] = size;
+	head.store( (write_at + record_length( size )) % buffer.size(), std::memory_order_release );
+}
+
+const unsigned char * capture_ring_t::begin_read( size_t & size )
+{
+	size_t t = tail.load( std::memory_order_relaxed );
+	const size_t h = head.load( std::memory_order_acquire );
+	if( t == h )
+		return NULL;
+	if( *(const uint64 *)&buffer[ t ] == WRAP_MARKER )
+		t = 0;
+	read_at = t;
+	read_size = size = (size_t)*(const uint64 *)&buffer[ t ];
+	return &buffer[ t + RECORD_HEADER ];
+}
+
+void capture_ring_t::end_read()
+{
+	tail.store( (read_at + record_length( read_size )) % buffer.size(), std::memory_order_release );
+}
+
+capture_t::capture_t( size_t capacity ): capacity( capacity ), stop( false )
+{
+}
+
+capture_t::~capture_t()
+{
+	shutdown();
+}
+
+unsigned char * capture_t::begin( const capture_entry_t & entry, size_t max_size )
+{
+	//the ring and the decoder are created with the first hit
+	if( !ring )
+		ring.reset( new capture_ring_t( capacity ) );
+	if( !thread.joinable() )
+	{
+		stop = false;
+		thread = std::thread( &capture_t::decoder, this );
+	}
+
+	unsigned char * p = ring->begin_write( sizeof( entry ) + max_size );
+	if( !p )
+		return NULL;
+	memcpy( p, &entry, sizeof( entry ) );
+	return p + sizeof( entry );
+}
+
+void capture_t::commit( size_t size )
+{
+	ring->end_write( sizeof( capture_entry_t ) + size );
+}
+
+bool capture_t::collect( std::vector<captured_number_t> & numbers )
+{
+	numbers.clear();
+	std::lock_guard<std::mutex> guard( lock );
+	numbers.swap( decoded );
+	return !numbers.empty();
+}
+
+void capture_t::shutdown()
+{
+	stop = true;
+	if( thread.joinable() )
+		thread.join();
+}
+
+void capture_t::decoder()
+{
+	std::vector<captured_number_t> batch;
+	while( !stop )
+	{
+		//everything that is in the ring now is one batch, the UI thread sees it at once
+		size_t size;
+		const unsigned char * p;
+		while( !stop && (p = ring->begin_read( size )) != NULL )
+		{
+			capture_entry_t entry;
+			memcpy( &entry, p, sizeof( entry ) );
+			const unsigned char * data = p + sizeof( entry );
+			size -= sizeof( entry );
+
+			batch.push_back( captured_number_t() );
+			captured_number_t & found = batch.back();
+			found.hit.address = (ea_t)entry.address;
+			found.hit.call_site = (ea_t)entry.call_site;
+			found.hit.sequence = entry.sequence;
+			found.hit.time = entry.time;
+			if( entry.base_idx == 0 )
+				mpz_import( found.number.get_mpz_t(), size / entry.word_size, entry.bignum_endian, entry.word_size, entry.word_endian, 0, data );
+			else
+				text_to_number( data, size, entry.base_idx, entry.bignum_endian, found.number );
+			ring->end_read();
+		}
+
+		if( !batch.empty() )
+		{
+			std::lock_guard<std::mutex> guard( lock );
+			if( decoded.empty() )
+				decoded.swap( batch );
+			else
+				decoded.insert( decoded.end(), batch.begin(), batch.end() );
+			batch.clear();
+			continue;
+		}
+		std::this_thread::sleep_for( std::chrono::milliseconds( DECODER_IDLE ) );
+	}
+}
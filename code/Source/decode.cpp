@@ -0,0 +1,71 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#include "decode.h"
+
+void digits_to_number( const unsigned char * digits, size_t count, unsigned int base, mpz_class & number )
+{
+	//mpn_set_str leaves zero limbs on top for leading zeros
+	while( count > 0 && digits[ 0 ] == 0 )
+	{
+		++digits;
+		--count;
+	}
+	if( count == 0 )
+	{
+		number = 0;
+		return;
+	}
+
+	//ceil(log2(base)) bits per digit and the extra limb mpn_set_str needs
+	unsigned int bits = 1;
+	while( (1u << bits) < base )
+	{
+		++bits;
+	}
+	std::vector<mp_limb_t> limbs( count * bits / GMP_NUMB_BITS + 2 );
+	const mp_size_t size = mpn_set_str( &limbs[ 0 ], digits, count, base );
+	mpz_import( number.get_mpz_t(), size, -1, sizeof( mp_limb_t ), 0, 0, &limbs[ 0 ] );
+}
+
+void append_digits( mpz_class & number, std::vector<unsigned char> & digits, unsigned int base )
+{
+	if( digits.empty() )
+		return;
+
+	mpz_class low;
+	digits_to_number( &digits[ 0 ], digits.size(), base, low );
+	if( number == 0 )
+	{
+		number = low;
+	}
+	else
+	{
+		mpz_class shift;
+		mpz_ui_pow_ui( shift.get_mpz_t(), base, digits.size() );
+		number = number * shift + low;
+	}
+	digits.clear();
+}
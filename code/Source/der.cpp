@@ -0,0 +1,114 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#include "der.h"
+
+//nested deeper than any key format
+#define DER_MAX_DEPTH 16
+
+bool der_read_header( const unsigned char * data, size_t size, size_t pos, der_tlv_t & tlv )
+{
+	if( pos + 2 > size )
+		return false;
+	tlv.tag = data[ pos ];
+	tlv.position = pos;
+	//high tag numbers are not used by the key formats
+	if( (tlv.tag & 0x1f) == 0x1f )
+		return false;
+
+	size_t p = pos + 1;
+	const unsigned char l = data[ p++ ];
+	if( l < 0x80 )
+	{
+		tlv.length = l;
+	}
+	else
+	{
+		const size_t k = l & 0x7f;
+		if( k == 0 || k > sizeof( size_t ) || p + k > size )
+			return false;
+		tlv.length = 0;
+		for( size_t j = 0; j < k; ++j )
+		{
+			tlv.length = (tlv.length << 8) | data[ p++ ];
+		}
+	}
+	tlv.offset = p;
+	return true;
+}
+
+bool der_read_tlv( const unsigned char * data, size_t size, size_t pos, der_tlv_t & tlv )
+{
+	return der_read_header( data, size, pos, tlv ) && tlv.length <= size - tlv.offset;
+}
+
+//the TLVs must fill [begin, end) exactly, on failure nothing is added
+static bool der_walk( const unsigned char * data, size_t begin, size_t end, unsigned int depth, std::vector<der_tlv_t> & integers )
+{
+	if( depth > DER_MAX_DEPTH )
+		return false;
+
+	const size_t found = integers.size();
+	for( size_t pos = begin; pos < end; )
+	{
+		der_tlv_t tlv;
+		if( !der_read_tlv( data, end, pos, tlv ) )
+		{
+			integers.resize( found );
+			return false;
+		}
+		const size_t next = tlv.offset + tlv.length;
+
+		if( tlv.tag == DER_INTEGER )
+		{
+			integers.push_back( tlv );
+		}
+		else if( tlv.tag & DER_CONSTRUCTED )
+		{
+			if( !der_walk( data, tlv.offset, next, depth + 1, integers ) )
+			{
+				integers.resize( found );
+				return false;
+			}
+		}
+		else if( tlv.tag == DER_OCTET_STRING || (tlv.tag == DER_BIT_STRING && tlv.length > 1 && data[ tlv.offset ] == 0) )
+		{
+			//PKCS#8 wraps the key in an OCTET STRING, SubjectPublicKeyInfo in a BIT STRING with no unused bits
+			//when the contents are not DER they are plain data
+			der_walk( data, tlv.offset + (tlv.tag == DER_BIT_STRING ? 1 : 0), next, depth + 1, integers );
+		}
+		pos = next;
+	}
+	return true;
+}
+
+bool der_integers( const unsigned char * data, size_t size, std::vector<der_tlv_t> & integers )
+{
+	integers.clear();
+	der_tlv_t tlv;
+	if( !der_read_tlv( data, size, 0, tlv ) )
+		return false;
+	return der_walk( data, 0, tlv.offset + tlv.length, 0, integers );
+}
@@ -42,37 +42,114 @@ mpz_class InvertMod( const mpz_class & x, const mpz_class & mod )
 	return z;
 }
 
-//binary multiplication / power
-ec_point_t elliptic_curve_t::times( mpz_class m, const ec_point_t r )
+//x mod n in [0, n)
+static mpz_class reduced( const mpz_class & x, const mpz_class & n )
 {
-	if( m == 0 )
-		return one();
+	mpz_class r;
+	mpz_fdiv_r( r.get_mpz_t(), x.get_mpz_t(), n.get_mpz_t() );
+	return r;
+}
 
-	if( m == 1 )
-		return ec_point_t( r );
+#define MAX_WNAF_WIDTH 8
 
-	if( m < 0 )
+//the width with the least additions for uses scalars of the given length
+//the table costs 2^(w-2) additions, every scalar about bits/(w+1)
+static unsigned int wnaf_width( size_t bits, size_t uses )
+{
+	unsigned int best = 2;
+	size_t best_cost = (size_t)-1;
+	for( unsigned int w = 2; w <= MAX_WNAF_WIDTH; ++w )
 	{
-
-		ec_point_t i = inverse( r );
-		return times( -m, i );
+		const size_t cost = ((size_t)1 << (w - 2)) + uses * (bits / (w + 1));
+		if( cost < best_cost )
+		{
+			best_cost = cost;
+			best = w;
+		}
 	}
-	ec_point_t c = one();
-
-	ec_point_t s = r;
+	return best;
+}
 
-	while( m > 0 )
+//width-w NAF of m >= 0, least significant digit first
+//every nonzero digit is odd and less than 2^(w-1) in absolute value, at least w-1 zeros follow it
+static void wnaf( mpz_class m, unsigned int w, std::vector<int> & digits )
+{
+	digits.clear();
+	const long modulus = 1L << w;
+	while( m != 0 )
 	{
-		if( (m & 1) == 1 )
+		long d = 0;
+		if( mpz_odd_p( m.get_mpz_t() ) )
 		{
-			c = plus( c, s );
+			d = (long)mpz_fdiv_ui( m.get_mpz_t(), modulus );
+			if( d >= modulus / 2 )
+				d -= modulus;
+			m -= d;
 		}
-		s = plus( s, s );
-		m = m >> 1;
+		digits.push_back( (int)d );
+		m >>= 1;
+	}
+}
+
+void elliptic_curve_t::precompute( const ec_point_t & r, size_t uses, ec_table_t & table )
+{
+	table.w = wnaf_width( mpz_sizeinbase( modulus().get_mpz_t(), 2 ), uses );
+	table.odd.resize( (size_t)1 << (table.w - 2) );
+	table.odd[ 0 ] = r;
+	if( table.odd.size() == 1 )
+		return;
+	const ec_point_t r2 = plus( r, r );
+	for( size_t i = 1; i < table.odd.size(); ++i )
+	{
+		table.odd[ i ] = plus( table.odd[ i - 1 ], r2 );
+	}
+}
+
+//left-to-right wNAF with the generic plus
+ec_point_t elliptic_curve_t::times( const mpz_class & m, const ec_table_t & table )
+{
+	if( m == 0 )
+		return one();
+
+	std::vector<int> digits;
+	wnaf( abs( m ), table.w, digits );
+	const bool negative = m < 0;
+
+	ec_point_t c = one();
+	for( size_t i = digits.size(); i-- > 0; )
+	{
+		c = plus( c, c );
+		const int d = digits[ i ];
+		if( d == 0 )
+			continue;
+		const ec_point_t & e = table.odd[ (d < 0 ? -d : d) / 2 ];
+		if( (d < 0) != negative )
+			c = plus( c, inverse( e ) );
+		else
+			c = plus( c, e );
 	}
 	return c;
 }
 
+void elliptic_curve_t::times( const std::vector<mpz_class> & m, const ec_table_t & table, std::vector<ec_point_t> & r )
+{
+	r.resize( m.size() );
+	for( size_t i = 0; i < m.size(); ++i )
+	{
+		r[ i ] = times( m[ i ], table );
+	}
+}
+
+ec_point_t elliptic_curve_t::times( const mpz_class & m, const ec_point_t & r )
+{
+	if( m == 0 )
+		return one();
+
+	ec_table_t table;
+	precompute( r, 1, table );
+	return times( m, table );
+}
+
 //===================================================================================
 //               https://hyperelliptic.org/EFD/g1p/auto-shortw.html
 //===================================================================================
@@ -133,9 +210,306 @@ ec_point_t ShortWeierstrass::inverse( const ec_point_t  & p1 )
 {
 	if( p1.inf )
 		return p1;
-	return ec_point_t( { p1.x, (-p1.y) % n, true } );
+	return ec_point_t( { p1.x, reduced( -p1.y, n ), false } );
 }
 
+//===================================================================================
+//               https://hyperelliptic.org/EFD/g1p/auto-shortw-jacobian.html
+//===================================================================================
+//the formulas are templates over the fields from field.h, with_field() picks the field by the size of n
+
+//dbl-2007-bl
+template <typename F> static void jacobian_twice( const F & f, const typename F::value_t & a, ec_jacobian_t<F> & P )
+{
+	typedef typename F::value_t V;
+	if( f.is_zero( P.z ) )
+		return;
+
+	V xx, yy, yyyy, zz, s, m, t;
+	f.mul( xx, P.x, P.x );
+	f.mul( yy, P.y, P.y );
+	f.mul( yyyy, yy, yy );
+	f.mul( zz, P.z, P.z );
+
+	//S = 2*((X1+YY)^2-XX-YYYY)
+	f.add( t, P.x, yy );
+	f.mul( s, t, t );
+	f.sub( s, s, xx );
+	f.sub( s, s, yyyy );
+	f.add( s, s, s );
+
+	//M = 3*XX+a*ZZ^2
+	f.mul( t, zz, zz );
+	f.mul( m, a, t );
+	f.add( m, m, xx );
+	f.add( m, m, xx );
+	f.add( m, m, xx );
+
+	//Z3 = (Y1+Z1)^2-YY-ZZ
+	f.add( t, P.y, P.z );
+	f.mul( P.z, t, t );
+	f.sub( P.z, P.z, yy );
+	f.sub( P.z, P.z, zz );
+
+	//X3 = M^2-2*S
+	f.mul( P.x, m, m );
+	f.sub( P.x, P.x, s );
+	f.sub( P.x, P.x, s );
+
+	//Y3 = M*(S-X3)-8*YYYY
+	f.sub( t, s, P.x );
+	f.mul( P.y, m, t );
+	f.add( yyyy, yyyy, yyyy );
+	f.add( yyyy, yyyy, yyyy );
+	f.add( yyyy, yyyy, yyyy );
+	f.sub( P.y, P.y, yyyy );
+}
+
+//madd-2007-bl, (qx, qy) is an affine point
+template <typename F> static void jacobian_add_affine( const F & f, const typename F::value_t & a, const typename F::value_t & one,
+	ec_jacobian_t<F> & P, const typename F::value_t & qx, const typename F::value_t & qy )
+{
+	typedef typename F::value_t V;
+	if( f.is_zero( P.z ) )
+	{
+		P.x = qx;
+		P.y = qy;
+		P.z = one;
+		return;
+	}
+
+	V z1z1, u2, s2, h, r, hh, i, j, v, t;
+	f.mul( z1z1, P.z, P.z );
+	f.mul( u2, qx, z1z1 );
+	f.mul( t, P.z, z1z1 );
+	f.mul( s2, qy, t );
+
+	f.sub( h, u2, P.x );
+	f.sub( r, s2, P.y );
+	f.add( r, r, r );
+
+	if( f.is_zero( h ) )
+	{
+		//the same x: either P == Q or P == -Q
+		if( f.is_zero( r ) )
+			jacobian_twice( f, a, P );
+		else
+			f.sub( P.z, P.z, P.z );
+		return;
+	}
+
+	f.mul( hh, h, h );
+	f.add( i, hh, hh );
+	f.add( i, i, i );
+	f.mul( j, h, i );
+	f.mul( v, P.x, i );
+
+	//Z3 = (Z1+H)^2-Z1Z1-HH
+	f.add( t, P.z, h );
+	f.mul( P.z, t, t );
+	f.sub( P.z, P.z, z1z1 );
+	f.sub( P.z, P.z, hh );
+
+	//2*Y1*J, with the old Y1
+	f.mul( t, P.y, j );
+	f.add( t, t, t );
+
+	//X3 = r^2-J-2*V
+	f.mul( P.x, r, r );
+	f.sub( P.x, P.x, j );
+	f.sub( P.x, P.x, v );
+	f.sub( P.x, P.x, v );
+
+	//Y3 = r*(V-X3)-2*Y1*J
+	f.sub( v, v, P.x );
+	f.mul( P.y, r, v );
+	f.sub( P.y, P.y, t );
+}
+
+//all points are converted with one inversion, see batch_invert(), the results have coordinates in [0, n)
+template <typename F> static void jacobian_affine( const F & f, const std::vector< ec_jacobian_t<F> > & P, std::vector<ec_point_t> & r )
+{
+	typedef typename F::value_t V;
+	std::vector<V> zinv( P.size() );
+	for( size_t i = 0; i < P.size(); ++i )
+	{
+		zinv[ i ] = P[ i ].z;
+	}
+	batch_invert( f, zinv );
+
+	r.resize( P.size() );
+	for( size_t i = 0; i < P.size(); ++i )
+	{
+		if( f.is_zero( P[ i ].z ) )
+		{
+			r[ i ] = ec_point_t{ 0, 0, true };
+			continue;
+		}
+		V zz, x, y;
+		f.mul( zz, zinv[ i ], zinv[ i ] );
+		f.mul( x, P[ i ].x, zz );
+		f.mul( zz, zz, zinv[ i ] );
+		f.mul( y, P[ i ].y, zz );
+		r[ i ] = ec_point_t{ f.get( x ), f.get( y ), false };
+	}
+}
+
+//the odd multiples are computed in Jacobian coordinates and stored affine, so the additions in times() are mixed
+//2*q is converted first, because the mixed addition needs it affine, the rest shares one inversion
+struct weierstrass_precompute_t
+{
+	typedef void result_t;
+
+	const mpz_class & a;
+	const ec_point_t & q;
+	ec_table_t & table;
+
+	template <typename F> void run( const F & f )
+	{
+		typedef typename F::value_t V;
+		V av, one, qx, qy;
+		f.set( av, a );
+		f.set( one, 1 );
+		f.set( qx, q.x );
+		f.set( qy, q.y );
+
+		std::vector< ec_jacobian_t<F> > J( 1 );
+		J[ 0 ].x = qx;
+		J[ 0 ].y = qy;
+		J[ 0 ].z = one;
+		jacobian_twice( f, av, J[ 0 ] );
+		std::vector<ec_point_t> q2;
+		jacobian_affine( f, J, q2 );
+		if( q2[ 0 ].inf )
+		{
+			//2*q == inf, every odd multiple is q
+			for( size_t i = 1; i < table.odd.size(); ++i )
+			{
+				table.odd[ i ] = table.odd[ 0 ];
+			}
+			return;
+		}
+
+		V q2x, q2y;
+		f.set( q2x, q2[ 0 ].x );
+		f.set( q2y, q2[ 0 ].y );
+		J.resize( table.odd.size() );
+		J[ 0 ].x = qx;
+		J[ 0 ].y = qy;
+		J[ 0 ].z = one;
+		for( size_t i = 1; i < J.size(); ++i )
+		{
+			J[ i ] = J[ i - 1 ];
+			jacobian_add_affine( f, av, one, J[ i ], q2x, q2y );
+		}
+
+		std::vector<ec_point_t> odd;
+		jacobian_affine( f, J, odd );
+		for( size_t i = 1; i < odd.size(); ++i )
+		{
+			table.odd[ i ] = odd[ i ];
+		}
+	}
+};
+
+void ShortWeierstrass::precompute( const ec_point_t & r, size_t uses, ec_table_t & table )
+{
+	ec_point_t q = r;
+	if( !q.inf )
+	{
+		q.x = reduced( q.x, n );
+		q.y = reduced( q.y, n );
+	}
+
+	table.w = wnaf_width( mpz_sizeinbase( n.get_mpz_t(), 2 ), uses );
+	table.odd.resize( (size_t)1 << (table.w - 2) );
+	table.odd[ 0 ] = q;
+	if( q.inf )
+	{
+		for( size_t i = 1; i < table.odd.size(); ++i )
+		{
+			table.odd[ i ] = q;
+		}
+		return;
+	}
+	if( table.odd.size() == 1 )
+		return;
+
+	weierstrass_precompute_t job = { a, q, table };
+	with_field( n, job );
+}
+
+//left-to-right wNAF in Jacobian coordinates for every scalar, one inversion for all of them at the end
+struct weierstrass_times_t
+{
+	typedef void result_t;
+
+	const mpz_class & a;
+	const std::vector<mpz_class> & m;
+	const ec_table_t & table;
+	std::vector<ec_point_t> & r;
+
+	template <typename F> void run( const F & f )
+	{
+		typedef typename F::value_t V;
+		V av, one;
+		f.set( av, a );
+		f.set( one, 1 );
+
+		//the table in the field, with the negated y for the negative digits
+		const size_t size = table.odd.size();
+		std::vector<V> ox( size ), oy( size ), ny( size );
+		for( size_t i = 0; i < size; ++i )
+		{
+			if( table.odd[ i ].inf )
+				continue;
+			f.set( ox[ i ], table.odd[ i ].x );
+			f.set( oy[ i ], table.odd[ i ].y );
+			f.sub( ny[ i ], oy[ i ], oy[ i ] );
+			f.sub( ny[ i ], ny[ i ], oy[ i ] );
+		}
+
+		std::vector< ec_jacobian_t<F> > P( m.size() );
+		std::vector<int> digits;
+		for( size_t k = 0; k < m.size(); ++k )
+		{
+			wnaf( abs( m[ k ] ), table.w, digits );
+			const bool negative = m[ k ] < 0;
+
+			P[ k ].x = one;
+			P[ k ].y = one;
+			f.sub( P[ k ].z, one, one );
+			for( size_t i = digits.size(); i-- > 0; )
+			{
+				jacobian_twice( f, av, P[ k ] );
+				const int d = digits[ i ];
+				if( d == 0 )
+					continue;
+				const size_t o = (d < 0 ? -d : d) / 2;
+				if( table.odd[ o ].inf )
+					continue;
+				jacobian_add_affine( f, av, one, P[ k ], ox[ o ], (d < 0) != negative ? ny[ o ] : oy[ o ] );
+			}
+		}
+		jacobian_affine( f, P, r );
+	}
+};
+
+void ShortWeierstrass::times( const std::vector<mpz_class> & m, const ec_table_t & table, std::vector<ec_point_t> & r )
+{
+	weierstrass_times_t job = { a, m, table, r };
+	with_field( n, job );
+}
+
+ec_point_t ShortWeierstrass::times( const mpz_class & m, const ec_table_t & table )
+{
+	if( m == 0 )
+		return one();
+
+	std::vector<ec_point_t> r;
+	times( std::vector<mpz_class>( 1, m ), table, r );
+	return r[ 0 ];
+}
 
 //===================================================================================
 //               https://hyperelliptic.org/EFD/g1p/auto-twisted.html
@@ -154,8 +528,8 @@ ec_point_t TwistedEdwards::plus( const ec_point_t & P, const ec_point_t & Q )
 	mpz_class d2 = (1 - s);
 	d2 = InvertMod( d2, n );
 
-	mpz_class x3 = (((P.x*Q.y) % n + (P.y*Q.x) % n) *d1) % n;
-	mpz_class y3 = (((P.y*Q.y) % n - (a*P.x*Q.x) % n) *d2) % n;
+	mpz_class x3 = reduced( ((P.x*Q.y) % n + (P.y*Q.x) % n) *d1, n );
+	mpz_class y3 = reduced( ((P.y*Q.y) % n - (a*P.x*Q.x) % n) *d2, n );
 
 	return ec_point_t{ x3, y3, x3 == 0 && y3 == 1 };
 }
@@ -185,7 +559,7 @@ ec_point_t TwistedEdwards::inverse( const ec_point_t  & p1 )
 {
 	if( p1.inf )
 		return p1;
-	return ec_point_t( { (-p1.x) % n, p1.y, p1.x == 0 && p1.y == 1 } );
+	return ec_point_t( { reduced( -p1.x, n ), p1.y, p1.x == 0 && p1.y == 1 } );
 }
 
 
@@ -205,9 +579,9 @@ ec_point_t Edwards::plus( const ec_point_t & P, const ec_point_t & Q )
 	mpz_class d2 = (1 - s)*c;
 	d2 = InvertMod( d2, n );
 
-	mpz_class x3 = (((P.x*Q.y) % n + (P.y*Q.x) % n) *d1) % n;
-	mpz_class y3 = (((P.y*Q.y) % n - (P.x*Q.x) % n) *d2) % n;
-	return ec_point_t{ x3, y3, x3 == 0 && y3 == c };
+	mpz_class x3 = reduced( ((P.x*Q.y) % n + (P.y*Q.x) % n) *d1, n );
+	mpz_class y3 = reduced( ((P.y*Q.y) % n - (P.x*Q.x) % n) *d2, n );
+	return ec_point_t{ x3, y3, x3 == 0 && y3 == reduced( c, n ) };
 }
 
 bool Edwards::test( const ec_point_t & p )
@@ -230,5 +604,241 @@ ec_point_t Edwards::inverse( const ec_point_t  & p1 )
 {
 	if( p1.inf )
 		return p1;
-	return ec_point_t( { (-p1.x) % n, p1.y, p1.x == 0 && p1.y == c } );
+	return ec_point_t( { reduced( -p1.x, n ), p1.y, p1.x == 0 && p1.y == c } );
+}
+
+//===================================================================================
+//               https://hyperelliptic.org/EFD/g1p/auto-twisted-projective.html
+//               https://hyperelliptic.org/EFD/g1p/auto-edwards-projective.html
+//===================================================================================
+//both forms share the addition: a*x^2 + y^2 = c^2*(1 + d*x^2*y^2) with c == 1 or a == 1
+
+template <typename F> struct edwards_constants_t
+{
+	typename F::value_t a;
+	typename F::value_t c;
+	typename F::value_t d;
+	typename F::value_t one;
+};
+
+//add-2008-bbjlp / add-2007-bl, unified, so it also doubles and P may be Q
+template <typename F> static void edwards_add( const F & f, const edwards_constants_t<F> & k, ec_projective_t<F> & P, const ec_projective_t<F> & Q )
+{
+	typedef typename F::value_t V;
+	V A, B, C, D, E, G, H, t, u;
+
+	f.mul( A, P.z, Q.z );
+	f.mul( B, A, A );
+	f.mul( C, P.x, Q.x );
+	f.mul( D, P.y, Q.y );
+	f.mul( t, C, D );
+	f.mul( E, k.d, t );
+	//F and G of the EFD
+	f.sub( G, B, E );
+	f.add( H, B, E );
+
+	//X3 = A*F*((X1+Y1)*(X2+Y2)-C-D)
+	f.add( t, P.x, P.y );
+	f.add( u, Q.x, Q.y );
+	f.mul( t, t, u );
+	f.sub( t, t, C );
+	f.sub( t, t, D );
+	f.mul( u, A, G );
+	f.mul( P.x, u, t );
+
+	//Y3 = A*G*(D-a*C)
+	f.mul( t, k.a, C );
+	f.sub( t, D, t );
+	f.mul( u, A, H );
+	f.mul( P.y, u, t );
+
+	//Z3 = c*F*G
+	f.mul( t, G, H );
+	f.mul( P.z, k.c, t );
+}
+
+//all points are converted with one inversion, see batch_invert()
+template <typename F> static void edwards_affine( const F & f, const edwards_constants_t<F> & k, const std::vector< ec_projective_t<F> > & P, std::vector<ec_point_t> & r )
+{
+	typedef typename F::value_t V;
+	std::vector<V> zinv( P.size() );
+	for( size_t i = 0; i < P.size(); ++i )
+	{
+		zinv[ i ] = P[ i ].z;
+	}
+	batch_invert( f, zinv );
+
+	r.resize( P.size() );
+	for( size_t i = 0; i < P.size(); ++i )
+	{
+		V x, y;
+		f.mul( x, P[ i ].x, zinv[ i ] );
+		f.mul( y, P[ i ].y, zinv[ i ] );
+		r[ i ] = ec_point_t{ f.get( x ), f.get( y ), f.is_zero( x ) && f.equal( y, k.c ) };
+	}
+}
+
+template <typename F> static void edwards_constants( const F & f, const mpz_class & a, const mpz_class & c, const mpz_class & d, edwards_constants_t<F> & k )
+{
+	f.set( k.a, a );
+	f.set( k.c, c );
+	f.set( k.d, d );
+	f.set( k.one, 1 );
+}
+
+struct edwards_precompute_t
+{
+	typedef void result_t;
+
+	const mpz_class & a;
+	const mpz_class & c;
+	const mpz_class & d;
+	ec_table_t & table;
+
+	template <typename F> void run( const F & f )
+	{
+		edwards_constants_t<F> k;
+		edwards_constants( f, a, c, d, k );
+
+		std::vector< ec_projective_t<F> > q( table.odd.size() );
+		f.set( q[ 0 ].x, table.odd[ 0 ].x );
+		f.set( q[ 0 ].y, table.odd[ 0 ].y );
+		q[ 0 ].z = k.one;
+		ec_projective_t<F> q2 = q[ 0 ];
+		edwards_add( f, k, q2, q2 );
+
+		for( size_t i = 1; i < q.size(); ++i )
+		{
+			q[ i ] = q[ i - 1 ];
+			edwards_add( f, k, q[ i ], q2 );
+		}
+
+		std::vector<ec_point_t> odd;
+		edwards_affine( f, k, q, odd );
+		for( size_t i = 1; i < odd.size(); ++i )
+		{
+			table.odd[ i ] = odd[ i ];
+		}
+	}
+};
+
+struct edwards_times_t
+{
+	typedef void result_t;
+
+	const mpz_class & a;
+	const mpz_class & c;
+	const mpz_class & d;
+	const std::vector<mpz_class> & m;
+	const ec_table_t & table;
+	std::vector<ec_point_t> & r;
+
+	template <typename F> void run( const F & f )
+	{
+		edwards_constants_t<F> k;
+		edwards_constants( f, a, c, d, k );
+
+		//the table in the field, -(x, y) == (-x, y)
+		const size_t size = table.odd.size();
+		std::vector< ec_projective_t<F> > plus( size ), minus( size );
+		for( size_t i = 0; i < size; ++i )
+		{
+			f.set( plus[ i ].x, table.odd[ i ].x );
+			f.set( plus[ i ].y, table.odd[ i ].y );
+			plus[ i ].z = k.one;
+			minus[ i ] = plus[ i ];
+			f.sub( minus[ i ].x, plus[ i ].x, plus[ i ].x );
+			f.sub( minus[ i ].x, minus[ i ].x, plus[ i ].x );
+		}
+
+		std::vector< ec_projective_t<F> > P( m.size() );
+		std::vector<int> digits;
+		for( size_t j = 0; j < m.size(); ++j )
+		{
+			wnaf( abs( m[ j ] ), table.w, digits );
+			const bool negative = m[ j ] < 0;
+
+			//the neutral point (0 : c : 1)
+			f.sub( P[ j ].x, k.one, k.one );
+			P[ j ].y = k.c;
+			P[ j ].z = k.one;
+			for( size_t i = digits.size(); i-- > 0; )
+			{
+				edwards_add( f, k, P[ j ], P[ j ] );
+				const int d = digits[ i ];
+				if( d == 0 )
+					continue;
+				const size_t o = (d < 0 ? -d : d) / 2;
+				edwards_add( f, k, P[ j ], (d < 0) != negative ? minus[ o ] : plus[ o ] );
+			}
+		}
+		edwards_affine( f, k, P, r );
+	}
+};
+
+//the odd multiples for the projective wNAF of both Edwards forms
+static void edwards_precompute( const mpz_class & a, const mpz_class & c, const mpz_class & d, const mpz_class & n,
+	const ec_point_t & r, size_t uses, ec_table_t & table )
+{
+	table.w = wnaf_width( mpz_sizeinbase( n.get_mpz_t(), 2 ), uses );
+	table.odd.resize( (size_t)1 << (table.w - 2) );
+	table.odd[ 0 ] = ec_point_t{ reduced( r.x, n ), reduced( r.y, n ), r.inf };
+	if( table.odd.size() == 1 )
+		return;
+
+	edwards_precompute_t job = { a, c, d, table };
+	with_field( n, job );
+}
+
+//zero scalars get the neutral point as one() returns it
+static void edwards_times( const mpz_class & a, const mpz_class & c, const mpz_class & d, const mpz_class & n,
+	const std::vector<mpz_class> & m, const ec_table_t & table, std::vector<ec_point_t> & r, const ec_point_t & neutral )
+{
+	edwards_times_t job = { a, c, d, m, table, r };
+	with_field( n, job );
+	for( size_t i = 0; i < m.size(); ++i )
+	{
+		if( m[ i ] == 0 )
+			r[ i ] = neutral;
+	}
+}
+
+void TwistedEdwards::precompute( const ec_point_t & r, size_t uses, ec_table_t & table )
+{
+	edwards_precompute( a, 1, d, n, r, uses, table );
+}
+
+void TwistedEdwards::times( const std::vector<mpz_class> & m, const ec_table_t & table, std::vector<ec_point_t> & r )
+{
+	edwards_times( a, 1, d, n, m, table, r, one() );
+}
+
+ec_point_t TwistedEdwards::times( const mpz_class & m, const ec_table_t & table )
+{
+	if( m == 0 )
+		return one();
+
+	std::vector<ec_point_t> r;
+	times( std::vector<mpz_class>( 1, m ), table, r );
+	return r[ 0 ];
+}
+
+void Edwards::precompute( const ec_point_t & r, size_t uses, ec_table_t & table )
+{
+	edwards_precompute( 1, c, d, n, r, uses, table );
+}
+
+void Edwards::times( const std::vector<mpz_class> & m, const ec_table_t & table, std::vector<ec_point_t> & r )
+{
+	edwards_times( 1, c, d, n, m, table, r, one() );
+}
+
+ec_point_t Edwards::times( const mpz_class & m, const ec_table_t & table )
+{
+	if( m == 0 )
+		return one();
+
+	std::vector<ec_point_t> r;
+	times( std::vector<mpz_class>( 1, m ), table, r );
+	return r[ 0 ];
 }
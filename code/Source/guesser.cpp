@@ -27,14 +27,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <mpirxx.h>
 #include <iostream>
 #include <vector>
+#include <unordered_map>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
 #include <time.h>
 #include "dumper.h"
 #include <sstream>
 #include "elliptic.h"
-
-int counter = 0;
-
-std::stringstream log_stream;
+#include "task_pool.h"
+#include "modular.h"
 
 
 struct ec_curve_info_t
@@ -56,14 +58,14 @@ struct ec_curve_info_t
 	{
 		pt = p;
 		curve = c;
-		name = counter++;
+		name = -1;
 	}
 };
 typedef ec_curve_info_t * pec_curve_info_t;
 
 #define Big mpz_class
 
-void wiener( const Big & n, const Big & e );
+void wiener( std::ostream & log, const Big & n, const Big & e );
 
 //borrowed from RAT
 
@@ -140,7 +142,7 @@ Big root( const Big & A, const mpir_ui & n )
 	return result;
 }
 
-bool Wener_Attack( const Big & n, const Big & e )
+bool Wener_Attack( std::ostream & log, const Big & n, const Big & e )
 {
 	/* Small prime difference attack a.k.a Wener attack */
 
@@ -169,18 +171,18 @@ bool Wener_Attack( const Big & n, const Big & e )
 		/* end of algo*/
 
 		/* print values */
-		log_stream << "Wener attact factorisation is:" << std::endl;
+		log << "Wener attact factorisation is:" << std::endl;
 		d = inverse( e, Big( (mpz_class)(p - 1)*(q - 1) ) );
-		log_stream << "d:" << d << std::endl;
-		log_stream << "p:" << p << std::endl;
-		log_stream << "q:" << q << std::endl;
+		log << "d:" << d << std::endl;
+		log << "p:" << p << std::endl;
+		log << "q:" << q << std::endl;
 		return true;
 
 	}
 }
 
 
-bool Wiener_Attack( const Big & n, const Big & e )
+bool Wiener_Attack( std::ostream & log, const Big & n, const Big & e )
 {
 	/*
 		Wiener Attack on RSA (small private exponent)
@@ -208,12 +210,17 @@ bool Wiener_Attack( const Big & n, const Big & e )
 
 	for( ;; )
 	{
+		//the expansion ended, small and degenerate inputs get here
+		if( iszero( bi ) )
+			break;
 		aj = crt / bi;
 		bj = crt%bi;
 		crt = bi;
 
 		pi = aj * pj + pk;
 		qi = aj * qj + qk;
+		if( iszero( pi ) )
+			break;
 
 		if( qi > l )
 		{
@@ -244,11 +251,11 @@ bool Wiener_Attack( const Big & n, const Big & e )
 	if( succes )
 	{
 		/* print values */
-		log_stream << "factorisation is:" << std::endl;
+		log << "factorisation is:" << std::endl;
 		d = inverse( e, (p - 1)*(q - 1) );
-		log_stream << "d:" << d << std::endl;
-		log_stream << "p:" << p << std::endl;
-		log_stream << "q:" << q << std::endl;
+		log << "d:" << d << std::endl;
+		log << "p:" << p << std::endl;
+		log << "q:" << q << std::endl;
 	}
 
 	return succes;
@@ -256,19 +263,19 @@ bool Wiener_Attack( const Big & n, const Big & e )
 
 
 
-void elliptic_info( const Big & x, const Big & y, const Big & a, const Big & b, const Big  & n )
+void elliptic_info( std::ostream & log, int name, const Big & x, const Big & y, const Big & a, const Big & b, const Big  & n )
 {
-	log_stream << "short Weierstrass curve: " << counter - 1 << std::endl << "x: " << x << std::endl << "y: " << y << std::endl;
-	log_stream << "a: " << a << std::endl;
-	log_stream << "b: " << b << std::endl;
-	log_stream << "p: " << n << std::endl << std::endl;
+	log << "short Weierstrass curve: " << name << std::endl << "x: " << x << std::endl << "y: " << y << std::endl;
+	log << "a: " << a << std::endl;
+	log << "b: " << b << std::endl;
+	log << "p: " << n << std::endl << std::endl;
 
 	Big delta = -16 * (4 * a*a*a + 27 * b*b);
 
-	log_stream << "discriminant= " << delta << std::endl;
+	log << "discriminant= " << delta << std::endl;
 	if( delta == 0 )
 	{
-		log_stream << "curve is singular" << std::endl;
+		log << "curve is singular" << std::endl;
 	}
 	else
 	{
@@ -282,15 +289,15 @@ void elliptic_info( const Big & x, const Big & y, const Big & a, const Big & b,
 		}
 		if( delta > 1 )
 		{
-			log_stream << "j-invariant = " << j << "/" << delta << std::endl;
+			log << "j-invariant = " << j << "/" << delta << std::endl;
 		}
 		else
 		{
-			log_stream << "j-invariant = " << j << std::endl;
+			log << "j-invariant = " << j << std::endl;
 		}
 		if( j == 0 || j == 1728 )
 		{
-			log_stream << "Curve is anomalous." << std::endl;
+			log << "Curve is anomalous." << std::endl;
 		}
 	}
 }
@@ -351,13 +358,13 @@ bool Edwards( const Big & x, const Big & y, const Big & c, const Big & d, const
 	return false;
 }
 
-void Edwards_info( const Big & x, const Big & y, const Big & c, const Big & d, const Big  & n )
+void Edwards_info( std::ostream & log, const Big & x, const Big & y, const Big & c, const Big & d, const Big  & n )
 {
-	log_stream << "Edwards curve: x^2 + y^2 = c^2*(1 + d*x^2*y^2)" << std::endl;
-	log_stream << "x: " << x << std::endl << "y: " << y << std::endl;
-	log_stream << "c: " << c << std::endl;
-	log_stream << "d: " << d << std::endl;
-	log_stream << "p: " << n << std::endl << std::endl;
+	log << "Edwards curve: x^2 + y^2 = c^2*(1 + d*x^2*y^2)" << std::endl;
+	log << "x: " << x << std::endl << "y: " << y << std::endl;
+	log << "c: " << c << std::endl;
+	log << "d: " << d << std::endl;
+	log << "p: " << n << std::endl << std::endl;
 }
 
 bool twisted_Edwards( const Big & x, const Big & y, const Big & a, const Big & d, const Big  & n, pec_curve_info_t &pt )
@@ -394,13 +401,13 @@ bool twisted_Edwards( const Big & x, const Big & y, const Big & a, const Big & d
 	return false;
 }
 
-void twisted_Edwards_info( const Big & x, const Big & y, const Big & a, const Big & d, const Big  & n )
+void twisted_Edwards_info( std::ostream & log, const Big & x, const Big & y, const Big & a, const Big & d, const Big  & n )
 {
-	log_stream << "twisted Edwards curve: a*x^2 + y^2 = 1 + d*x^2*y^2" << std::endl;
-	log_stream << "x: " << x << std::endl << "y: " << y << std::endl;
-	log_stream << "a: " << a << std::endl;
-	log_stream << "d: " << d << std::endl;
-	log_stream << "p: " << n << std::endl << std::endl;
+	log << "twisted Edwards curve: a*x^2 + y^2 = 1 + d*x^2*y^2" << std::endl;
+	log << "x: " << x << std::endl << "y: " << y << std::endl;
+	log << "a: " << a << std::endl;
+	log << "d: " << d << std::endl;
+	log << "p: " << n << std::endl << std::endl;
 }
 
 
@@ -539,16 +546,263 @@ bool Prime( Big n )
 }
 
 
-funkce<operace3> fce3[] = { { Plus, "+" }, { Minus, "-" }, { Krat, "*" }, { Deleno, "/" }, { Mod, "%" }, { Inverse, "^-1 mod " } };
+#define RESIDUES 4
+
+//primes just below 2^32, a product of two residues fits into 64 bits
+const uint64_t residue_primes[ RESIDUES ] = { 4294967291u, 4294967279u, 4294967231u, 4294967197u };
+
+//fingerprint of a number: its residues modulo residue_primes
+//a relation that fails on the residues fails on the numbers, only the survivors are checked with MPIR
+struct residues_t
+{
+	uint32_t r[ RESIDUES ];
+
+	void set( const Big & n )
+	{
+		for( int i = 0; i < RESIDUES; ++i )
+		{
+			r[ i ] = (uint32_t)mpz_fdiv_ui( n.get_mpz_t(), (unsigned long)residue_primes[ i ] );
+		}
+	}
+
+	bool operator==(const residues_t & other) const
+	{
+		for( int i = 0; i < RESIDUES; ++i )
+		{
+			if( r[ i ] != other.r[ i ] )
+				return false;
+		}
+		return true;
+	}
+
+	bool operator!=(const residues_t & other) const
+	{
+		return !(*this == other);
+	}
+
+	size_t hash() const
+	{
+		size_t h = 2166136261u;
+		for( int i = 0; i < RESIDUES; ++i )
+		{
+			h = (h ^ r[ i ]) * 16777619u;
+		}
+		return h;
+	}
+};
+
+//value functions for the hash join: compute f(a,b) once per pair, false if there is nothing to look up
+typedef bool hodnota3( const Big &, const Big &, Big & );
+
+//the same on fingerprints, used instead of hodnota3 where the relation is a ring operation
+typedef bool otisk3( const residues_t &, const residues_t &, residues_t & );
+
+bool PlusResidues( const residues_t & a, const residues_t & b, residues_t & c )
+{
+	for( int i = 0; i < RESIDUES; ++i )
+	{
+		const uint64_t s = (uint64_t)a.r[ i ] + b.r[ i ];
+		c.r[ i ] = (uint32_t)(s >= residue_primes[ i ] ? s - residue_primes[ i ] : s);
+	}
+	return true;
+}
+
+bool MinusResidues( const residues_t & a, const residues_t & b, residues_t & c )
+{
+	for( int i = 0; i < RESIDUES; ++i )
+	{
+		const uint64_t s = (uint64_t)a.r[ i ] + residue_primes[ i ] - b.r[ i ];
+		c.r[ i ] = (uint32_t)(s >= residue_primes[ i ] ? s - residue_primes[ i ] : s);
+	}
+	return true;
+}
+
+bool KratResidues( const residues_t & a, const residues_t & b, residues_t & c )
+{
+	for( int i = 0; i < RESIDUES; ++i )
+	{
+		c.r[ i ] = (uint32_t)(((uint64_t)a.r[ i ] * b.r[ i ]) % residue_primes[ i ]);
+	}
+	return true;
+}
+
+bool PlusValue( const Big & a, const Big & b, Big & c )
+{
+	c = a + b;
+	return true;
+}
+
+bool MinusValue( const Big & a, const Big & b, Big & c )
+{
+	c = a - b;
+	return true;
+}
+
+bool KratValue( const Big & a, const Big & b, Big & c )
+{
+	c = a * b;
+	return true;
+}
+
+bool DelenoValue( const Big & a, const Big & b, Big & c )
+{
+	if( b == 0 ) return false;
+	if( b == 1 ) return false;
+	if( a < b ) return false;
+	c = a / b;
+	return true;
+}
+
+bool ModValue( const Big & a, const Big & b, Big & c )
+{
+	if( b == 0 ) return false;
+	if( b == 1 ) return false;
+	c = a % b;
+	return true;
+}
+
+bool InverseValue( const Big & a, const Big & b, Big & c )
+{
+	if( b == 0 ) return false;
+	if( b == 1 ) return false;
+	if( a == 1 ) return false;
+	if( a == 0 ) return false;
+	return mpz_invert( c.get_mpz_t(), a.get_mpz_t(), b.get_mpz_t() ) != 0;
+}
+
+struct relace3
+{
+	operace3 *nazev;
+	hodnota3 *hodnota;
+	otisk3 *otisk;
+	char *text;
+};
+
+relace3 fce3[] = {
+		{ Plus, PlusValue, PlusResidues, "+" },
+		{ Minus, MinusValue, MinusResidues, "-" },
+		{ Krat, KratValue, KratResidues, "*" },
+		{ Deleno, DelenoValue, 0, "/" },
+		{ Mod, ModValue, 0, "%" },
+		{ Inverse, InverseValue, 0, "^-1 mod " }
+};
+
+//value functions for the modular search: (a op b) mod c from ra = a mod c, rb = b mod c (both in [0,c))
+//the result must be the same as the one of the predicate, which uses truncating %
+typedef bool hodnota4( const Big & ra, const Big & rb, const Big & a, const Big & b, const Big & c, Big & d );
+
+bool PlusModValue( const Big & ra, const Big & rb, const Big & a, const Big & b, const Big & c, Big & d )
+{
+	if( a < 0 || b < 0 )
+	{
+		d = (a + b) % c;
+		return true;
+	}
+	d = ra + rb;
+	if( d >= c )
+		d -= c;
+	return true;
+}
+
+bool MinusModValue( const Big & ra, const Big & rb, const Big & a, const Big & b, const Big & c, Big & d )
+{
+	if( a < 0 || b < 0 )
+	{
+		d = (a - b) % c;
+		return true;
+	}
+	d = ra - rb;
+	if( d < 0 )
+		d += c;
+	//a - b is negative, so is its remainder
+	if( a < b && d != 0 )
+		d -= c;
+	return true;
+}
+
+bool DivModValue( const Big & ra, const Big & rb, const Big & a, const Big & b, const Big & c, Big & d )
+{
+	if( b == 0 ) return false;
+	d = (a / b) % c;
+	return true;
+}
+
+bool MulModValue( const Big & ra, const Big & rb, const Big & a, const Big & b, const Big & c, Big & d )
+{
+	if( a < 0 || b < 0 )
+	{
+		d = (a * b) % c;
+		return true;
+	}
+	mpz_mul( d.get_mpz_t(), ra.get_mpz_t(), rb.get_mpz_t() );
+	mpz_tdiv_r( d.get_mpz_t(), d.get_mpz_t(), c.get_mpz_t() );
+	return true;
+}
+
+bool Podil( Big a, Big b, Big c )
+{
+	if( b == 0 ) return false;
+	return (a / b) == c;
+}
+
+struct relace4
+{
+	operace4 *nazev;
+	hodnota4 *hodnota;
+	operace3 *bez_modulu;
+	char *text;
+};
 
-funkce<operace4> fce4[] = {
-		{ PlusMod, "(%s+%s) mod %s == %s\n" },
-		{ MinusMod, "(%s-%s) mod %s == %s\n" },
-		{ DivMod, "(%s/%s) mod %s == %s\n" },
-		{ MulMod, "(%s*%s) mod %s == %s\n" },
-		{ PowerMod, "pow(%s, %s, %s)==%s\n" }
+//PowerMod has no value function here, it is searched by search_modexp together with the RSA attacks
+relace4 fce4[] = {
+		{ PlusMod, PlusModValue, Plus, "(%s+%s) mod %s == %s\n" },
+		{ MinusMod, MinusModValue, Minus, "(%s-%s) mod %s == %s\n" },
+		{ DivMod, DivModValue, Podil, "(%s/%s) mod %s == %s\n" },
+		{ MulMod, MulModValue, Krat, "(%s*%s) mod %s == %s\n" },
+		{ PowerMod, 0, 0, "pow(%s, %s, %s)==%s\n" }
 };
 
+//fce4 texts are printf like, every %s is replaced by the next number
+std::string format4( const char * text, const Big & a, const Big & b, const Big & c, const Big & d )
+{
+	const Big * args[] = { &a, &b, &c, &d };
+	std::string s;
+	size_t arg = 0;
+	for( const char * p = text; *p; ++p )
+	{
+		if( p[ 0 ] == '%' && p[ 1 ] == 's' && arg < arraysz( args ) )
+		{
+			s += args[ arg++ ]->get_str();
+			++p;
+		}
+		else
+		{
+			s += *p;
+		}
+	}
+	return s;
+}
+
+//the part of powmod_test that does not depend on y
+bool powmod_args( const Big & x, const Big & e, const Big & n )
+{
+	if( n < 2 )
+		return false;
+	if( iszero( e ) )
+		return false;
+	if( x > n )
+		return false;
+
+	if( x == -1 )
+		return false;
+
+	if( e < 0 )
+		return false;
+	if( isone( x ) )
+		return false;
+	return true;
+}
+
 
 bool powmod_test( const Big & x, const Big & e, const Big & n, const Big & y )
 {
@@ -574,7 +828,8 @@ bool powmod_test( const Big & x, const Big & e, const Big & n, const Big & y )
 
 
 
-bool rsa_m_d_n( const Big & m, const Big & d, const Big & n )
+//the part of rsa_m_d_n that does not depend on m^d mod n
+bool rsa_m_d_n_args( const Big & m, const Big & d, const Big & n )
 {
 	if( iszero( n ) )
 		return false;
@@ -594,17 +849,19 @@ bool rsa_m_d_n( const Big & m, const Big & d, const Big & n )
 		return false;
 	if( n < d )
 		return false;
+	return true;
+}
 
-	Big p = pow( m, d, n );
-
-
+//p is m^d mod n
+bool rsa_m_d_n( std::ostream & log, const Big & m, const Big & d, const Big & n, Big p )
+{
 	if( len( p ) < len( n ) - 2 )
 	{
-		log_stream << "possible decrypted rsa message:" << std::endl;
-		log_stream << "m: " << m << std::endl;
-		log_stream << "n: " << n << std::endl;
-		log_stream << "d: " << d << std::endl;
-		log_stream << "p: " << p << std::endl;
+		log << "possible decrypted rsa message:" << std::endl;
+		log << "m: " << m << std::endl;
+		log << "n: " << n << std::endl;
+		log << "d: " << d << std::endl;
+		log << "p: " << p << std::endl;
 
 		std::string s;
 		bool ok = true;
@@ -622,7 +879,7 @@ bool rsa_m_d_n( const Big & m, const Big & d, const Big & n )
 			p = p / 256;
 		}
 		if( ok )
-			log_stream << "p2: " << s.c_str() << std::endl;
+			log << "p2: " << s.c_str() << std::endl;
 
 		return true;
 	}
@@ -632,7 +889,8 @@ bool rsa_m_d_n( const Big & m, const Big & d, const Big & n )
 	}
 }
 
-bool rsa_n_e_d( const Big & n, const Big & e, const Big & d )
+//the part of rsa_n_e_d without the exponentiations
+bool rsa_n_e_d_args( const Big & n, const Big & e, const Big & d )
 {
 	if( iszero( n ) )
 		return false;
@@ -656,6 +914,13 @@ bool rsa_n_e_d( const Big & n, const Big & e, const Big & d )
 	//ale stejne se zkou vechny monosti, take je to jedno
 	if( e > d )
 		return false;
+	return true;
+}
+
+bool rsa_n_e_d( const Big & n, const Big & e, const Big & d )
+{
+	if( !rsa_n_e_d_args( n, e, d ) )
+		return false;
 	if( (pow( pow( e, e, n ), d, n ) == e) && (pow( pow( d, e, n ), d, n ) == d) )
 		//if ((pow(pow(17, e, n), d, n) == 17))
 	{
@@ -668,12 +933,12 @@ bool rsa_n_e_d( const Big & n, const Big & e, const Big & d )
 }
 
 //faktorizuje n, pokud mme e a d
-bool rsa_n_e_d_factor( const Big & n, const Big & e, const Big & d )
+bool rsa_n_e_d_factor( std::ostream & log, const Big & n, const Big & e, const Big & d )
 {
 	Big u = (e*d - 1);
 	int c = 0;
 
-	log_stream << "e*d-1: " << u << std::endl;
+	log << "e*d-1: " << u << std::endl;
 
 	if( u == 0 )
 		return false;
@@ -710,8 +975,8 @@ bool rsa_n_e_d_factor( const Big & n, const Big & e, const Big & d )
 			z2 = pow( z, 2, n );
 			if( counter++ > c )
 			{
-				log_stream << "neco je spatne v rsa_n_e_d_factor" << std::endl;
-				log_stream << "counter: " << counter << std::endl;
+				log << "neco je spatne v rsa_n_e_d_factor" << std::endl;
+				log << "counter: " << counter << std::endl;
 				return false;
 			}
 
@@ -719,20 +984,20 @@ bool rsa_n_e_d_factor( const Big & n, const Big & e, const Big & d )
 		//cout << "counter: " << counter <<std::endl;
 		delitel = gcd( z - 1, n );
 	} while( delitel == 1 || delitel == n );
-	log_stream << n << " = " << delitel << " * " << n / delitel << std::endl << std::endl;
+	log << n << " = " << delitel << " * " << n / delitel << std::endl << std::endl;
 	return true;
 }
 
-void rsa_n_e_d_info( const Big & n, const Big & e, const Big & d )
+void rsa_n_e_d_info( std::ostream & log, const Big & n, const Big & e, const Big & d )
 {
-	log_stream << "rsa magic numbers:" << std::endl;
-	log_stream << "n: " << n << std::endl;
-	log_stream << "e: " << e << std::endl;
-	log_stream << "d: " << d << std::endl << std::endl;
-	wiener( n, d );
+	log << "rsa magic numbers:" << std::endl;
+	log << "n: " << n << std::endl;
+	log << "e: " << e << std::endl;
+	log << "d: " << d << std::endl << std::endl;
+	wiener( log, n, d );
 }
 
-void wiener( const Big & n, const Big & e )
+void wiener( std::ostream & log, const Big & n, const Big & e )
 {
 	//Given p>0 and q>1
 	/*
@@ -805,15 +1070,15 @@ void wiener( const Big & n, const Big & e )
 
 					if( sqr * sqr == dis )
 					{
-						log_stream << "Wiener attack with " << std::endl;
-						log_stream << "n:" << n << std::endl;
-						log_stream << "e:" << e << std::endl;
-
-						log_stream << "factorisation is:" << std::endl;
-						log_stream << "c:" << MAXWIENER - c << std::endl;
-						log_stream << "d:" << d << std::endl;
-						log_stream << "p:" << (1 - fin - sqr + n) / 2 << std::endl;
-						log_stream << "q:" << (1 - fin + sqr + n) / 2 << std::endl;
+						log << "Wiener attack with " << std::endl;
+						log << "n:" << n << std::endl;
+						log << "e:" << e << std::endl;
+
+						log << "factorisation is:" << std::endl;
+						log << "c:" << MAXWIENER - c << std::endl;
+						log << "d:" << d << std::endl;
+						log << "p:" << (1 - fin - sqr + n) / 2 << std::endl;
+						log << "q:" << (1 - fin + sqr + n) / 2 << std::endl;
 						return;
 					}
 				}
@@ -823,7 +1088,7 @@ void wiener( const Big & n, const Big & e )
 		}
 	}
 end:
-	//log_stream << "...failed." << std::endl;
+	//log << "...failed." << std::endl;
 
 	;
 }
@@ -852,258 +1117,966 @@ int mensi( const Big * a, const Big * b )
 	}
 }
 
-#define MAX_NUMBERS 100
+//hash index of dumped numbers: fingerprint -> positions in the number store
+class number_index_t
+{
+	typedef std::unordered_multimap<size_t, unsigned int> map_t;
+	map_t map;
+public:
+	typedef map_t::const_iterator iterator;
 
-std::string guess_relations( number_list_t & numbers )
+	void build( const std::vector<residues_t> & residues )
+	{
+		const unsigned int size = residues.size();
+		map.clear();
+		map.reserve( size );
+		for( unsigned int i = 0; i < size; ++i )
+		{
+			map.insert( map_t::value_type( residues[ i ].hash(), i ) );
+		}
+	}
+
+	//positions with the same hash, the fingerprints still have to be compared
+	std::pair<iterator, iterator> candidates( const residues_t & key ) const
+	{
+		return map.equal_range( key.hash() );
+	}
+};
+
+//the dumped numbers are not copied, every search works with indices into the store
+class number_store_t
 {
-	ec_curve_info_t * body[ MAX_NUMBERS ];
-	unsigned int body_size = 0;
-	//bool_vector_t pouzite;
-	Big cisla[ MAX_NUMBERS ] = { 0 };
-	unsigned int cisla_size = 0;
-	bool pouzite[ MAX_NUMBERS ] = { 0 };
+	const number_list_t & numbers;
+	std::vector<residues_t> fingerprints;
+	number_index_t index;
+public:
+	number_store_t( const number_list_t & list ): numbers( list ), fingerprints( list.size() )
+	{
+		for( size_t i = 0; i < numbers.size(); ++i )
+		{
+			fingerprints[ i ].set( numbers[ i ] );
+		}
+		index.build( fingerprints );
+	}
 
-	log_stream.str( std::string() );
+	unsigned int size() const
+	{
+		return numbers.size();
+	}
 
-	if( numbers.size() > 20 )
-		return "too many numbers";
+	const Big & operator[]( unsigned int i ) const
+	{
+		return numbers[ i ];
+	}
 
-	std::copy( numbers.begin(), numbers.end(), cisla );
+	const residues_t & residues( unsigned int i ) const
+	{
+		return fingerprints[ i ];
+	}
 
-	cisla_size = numbers.size();
+	const number_index_t & get_index() const
+	{
+		return index;
+	}
+};
 
 #define prnt(x) cout << #x ": " << (x) <<std::endl;
 
 
-#define smycka(iter) for (unsigned int iter=0; iter<cisla_size; iter++)
-#define smycka2(iter) for (unsigned int iter=0; iter<body_size; iter++)
+#define smycka(iter) for (unsigned int iter=0; iter<cisla.size(); iter++)
+#define smycka2(iter) for (unsigned int iter=0; iter<body.size(); iter++)
 #define prespole(pole, iter) for(int iter=0; iter < arraysz(pole); iter++)
 
-#pragma omp parallel sections
+//a point found by one of the curve tests for the tuple j,k,l,m,n
+struct curve_finding_t
+{
+	unsigned int j, k, l, m, n;
+	pec_curve_info_t weierstrass;
+	bool edwards;
+	pec_curve_info_t twisted;
+};
+
+//findings of one task, they are merged in task order so the output does not depend on scheduling
+struct findings_t
+{
+	std::string log;
+	std::vector<curve_finding_t> curves;
+};
+
+void search_fce3( const number_store_t & cisla, int i, unsigned int j, std::ostream & log )
+{
+	//f(a,b) is computed once per ordered pair and looked up in the index
+	//ring operations are computed only on the fingerprints
+	const number_index_t & index = cisla.get_index();
+
+	smycka( k )
 	{
-#pragma omp section 
-		if( cisla_size >= 3 ) //mame dost cisel na 3 argumenty
+		if( j == k ) continue;
+		residues_t key;
+		if( fce3[ i ].otisk )
+		{
+			if( !(fce3[ i ].otisk)(cisla.residues( j ), cisla.residues( k ), key) )
+				continue;
+		}
+		else
+		{
+			Big value;
+			if( !(fce3[ i ].hodnota)(cisla[ j ], cisla[ k ], value) )
+				continue;
+			key.set( value );
+		}
+
+		std::pair<number_index_t::iterator, number_index_t::iterator> hits = index.candidates( key );
+		for( number_index_t::iterator it = hits.first; it != hits.second; ++it )
 		{
-			smycka( j )
+			const unsigned int l = it->second;
+			if( l == j ) continue;
+			if( l == k ) continue;
+			if( cisla.residues( l ) != key ) continue;
+			if( (fce3[ i ].nazev)(cisla[ j ], cisla[ k ], cisla[ l ]) )
 			{
-				smycka( k )
-				{
-					if( j == k ) continue;
-					smycka( l )
-					{
-						if( l == j ) continue;
-						if( l == k ) continue;
-						if( rsa_m_d_n( cisla[ j ], cisla[ k ], cisla[ l ] ) )
-						{
-
-						}
-						if( rsa_n_e_d( cisla[ j ], cisla[ k ], cisla[ l ] ) )
-						{
-							rsa_n_e_d_info( cisla[ j ], cisla[ k ], cisla[ l ] );
-							rsa_n_e_d_factor( cisla[ j ], cisla[ k ], cisla[ l ] );
-						}
-
-						prespole( fce3, i )
-						{
-							if( (fce3[ i ].nazev)(cisla[ j ], cisla[ k ], cisla[ l ]) )
-							{
-								log_stream << cisla[ j ] << " " << fce3[ i ].text << " " << cisla[ k ] << " == " << cisla[ l ] << std::endl;
-							}
-						}
-					}
-				}
-				if( wasbreak() )
-				{
-					goto end;
-				}
+				log << cisla[ j ] << " " << fce3[ i ].text << " " << cisla[ k ] << " == " << cisla[ l ] << std::endl;
+			}
+		}
+	}
+}
+
+//every exponentiation modulo n = cisla[ l ]: x^e mod n == y, decrypted rsa messages m^d mod n and rsa triples n,e,d
+//the modulus is fixed for the whole task, so its context and the window table of each base are built once
+void search_modexp( const number_store_t & cisla, unsigned int l, std::ostream & log, const task_pool_t & pool )
+{
+	const number_index_t & index = cisla.get_index();
+	const Big & n = cisla[ l ];
+	if( n < 2 )
+		return;
+
+	const modulus_context_t ctx( n );
+	std::vector<unsigned int> exponents;
+	Big y;
+
+	//x^e mod n is shared by powmod_test and rsa_m_d_n
+	smycka( j )
+	{
+		if( j == l ) continue;
+		exponents.clear();
+		smycka( k )
+		{
+			if( k == j ) continue;
+			if( k == l ) continue;
+			if( powmod_args( cisla[ j ], cisla[ k ], n ) || rsa_m_d_n_args( cisla[ j ], cisla[ k ], n ) )
+				exponents.push_back( k );
+		}
+		if( exponents.empty() )
+			continue;
+
+		const powm_table_t table( ctx, cisla[ j ], exponents.size() );
+		for( size_t i = 0; i < exponents.size(); ++i )
+		{
+			const unsigned int k = exponents[ i ];
+			table.pow( y, cisla[ k ] );
+
+			if( rsa_m_d_n_args( cisla[ j ], cisla[ k ], n ) )
+				rsa_m_d_n( log, cisla[ j ], cisla[ k ], n, y );
+
+			if( !powmod_args( cisla[ j ], cisla[ k ], n ) )
+				continue;
+			if( y == cisla[ j ] )
+				continue;
+
+			residues_t key;
+			key.set( y );
+			std::pair<number_index_t::iterator, number_index_t::iterator> hits = index.candidates( key );
+			for( number_index_t::iterator it = hits.first; it != hits.second; ++it )
+			{
+				const unsigned int m = it->second;
+				if( m == j ) continue;
+				if( m == k ) continue;
+				if( m == l ) continue;
+				if( cisla[ m ] != y ) continue;
+
+				log << "x^e mod n == y where" << std::endl;
+				log << "x: " << cisla[ j ] << std::endl;
+				log << "e: " << cisla[ k ] << std::endl;
+				log << "n: " << cisla[ l ] << std::endl;
+				log << "y: " << cisla[ m ] << std::endl;
+				wiener( log, cisla[ l ], cisla[ k ] );
+				Wiener_Attack( log, cisla[ l ], cisla[ k ] );
+				//Wener_Attack(log, cisla[l], cisla[k]);
+			}
+		}
+		if( pool.stopped() )
+			return;
+	}
+
+	//rsa_n_e_d: (e^e)^d mod n == e is tested with one table lookup per d, (d^e)^d mod n == d only for the survivors
+	smycka( k )
+	{
+		if( k == l ) continue;
+		exponents.clear();
+		smycka( m )
+		{
+			if( m == l ) continue;
+			if( m == k ) continue;
+			if( rsa_n_e_d_args( n, cisla[ k ], cisla[ m ] ) )
+				exponents.push_back( m );
+		}
+		if( exponents.empty() )
+			continue;
+
+		ctx.pow( y, cisla[ k ], cisla[ k ] );
+		const powm_table_t table( ctx, y, exponents.size() );
+		for( size_t i = 0; i < exponents.size(); ++i )
+		{
+			const unsigned int m = exponents[ i ];
+			if( table.pow( cisla[ m ] ) != cisla[ k ] )
+				continue;
+			if( rsa_n_e_d( n, cisla[ k ], cisla[ m ] ) )
+			{
+				rsa_n_e_d_info( log, n, cisla[ k ], cisla[ m ] );
+				rsa_n_e_d_factor( log, n, cisla[ k ], cisla[ m ] );
 			}
 		}
-#pragma omp section 
-		if( cisla_size >= 4 )
+		if( pool.stopped() )
+			return;
+	}
+}
+
+#define MIN_MODULUS 65536
+
+//(a op b) mod c == d for the modulus c = cisla[ l ]
+//all numbers are reduced once, then every pair costs one operation on residues and a lookup
+void search_fce4( const number_store_t & cisla, unsigned int l, std::ostream & log, const task_pool_t & pool )
+{
+	const number_index_t & index = cisla.get_index();
+	const Big & c = cisla[ l ];
+	//small moduli match by chance all the time
+	if( c < MIN_MODULUS )
+		return;
+
+	std::vector<Big> zbytky( cisla.size() );
+	smycka( i )
+	{
+		mpz_fdiv_r( zbytky[ i ].get_mpz_t(), cisla[ i ].get_mpz_t(), c.get_mpz_t() );
+	}
+
+	smycka( j )
+	{
+		if( j == l ) continue;
+		smycka( k )
 		{
-			smycka( j )
+			if( k == j ) continue;
+			if( k == l ) continue;
+			prespole( fce4, i )
 			{
-				smycka( k )
+				if( !fce4[ i ].hodnota )
+					continue;
+				Big d;
+				if( !(fce4[ i ].hodnota)(zbytky[ j ], zbytky[ k ], cisla[ j ], cisla[ k ], c, d) )
+					continue;
+
+				residues_t key;
+				key.set( d );
+				std::pair<number_index_t::iterator, number_index_t::iterator> hits = index.candidates( key );
+				for( number_index_t::iterator it = hits.first; it != hits.second; ++it )
 				{
-					if( j == k ) continue;
-					smycka( l )
-					{
-						if( l == j ) continue;
-						if( l == k ) continue;
-						smycka( m )
-						{
-							if( m == j ) continue;
-							if( m == k ) continue;
-							if( m == l ) continue;
-							if( powmod_test( cisla[ j ], cisla[ k ], cisla[ l ], cisla[ m ] ) )
-							{
-								log_stream << "x^e mod n == y where" << std::endl;
-								log_stream << "x: " << cisla[ j ] << std::endl;
-								log_stream << "e: " << cisla[ k ] << std::endl;
-								log_stream << "n: " << cisla[ l ] << std::endl;
-								log_stream << "y: " << cisla[ m ] << std::endl;
-								wiener( cisla[ l ], cisla[ k ] );
-								Wiener_Attack( cisla[ l ], cisla[ k ] );
-								//Wener_Attack(cisla[l], cisla[k]);
-							}
-						}
-					}
+					const unsigned int m = it->second;
+					if( m == j ) continue;
+					if( m == k ) continue;
+					if( m == l ) continue;
+					if( cisla[ m ] != d ) continue;
+					if( !(fce4[ i ].nazev)(cisla[ j ], cisla[ k ], c, cisla[ m ]) )
+						continue;
+					//nothing was reduced, this is just the plain relation
+					if( (fce4[ i ].bez_modulu)(cisla[ j ], cisla[ k ], cisla[ m ]) )
+						continue;
+
+					log << format4( fce4[ i ].text, cisla[ j ], cisla[ k ], c, cisla[ m ] );
 				}
-				if( wasbreak() )
+			}
+		}
+		if( pool.stopped() )
+			return;
+	}
+}
+
+typedef std::unordered_multimap<size_t, unsigned int> residue_index_t;
+
+//the numbers reduced mod m and indexed by the residue, m is the curve modulus or one of its divisors
+struct residues_mod_t
+{
+	Big m;
+	std::vector<Big> zbytky;
+	residue_index_t index;
+
+	void build( const big_hash_t & hash )
+	{
+		index.reserve( zbytky.size() );
+		for( unsigned int i = 0; i < zbytky.size(); ++i )
+		{
+			index.insert( residue_index_t::value_type( hash( zbytky[ i ] ), i ) );
+		}
+	}
+};
+
+//a*d == b (mod m) is solved by d == d0 (mod m/g) with g = gcd(a, m) and d0 = (b/g) * (a/g)^-1, if g divides b
+//g and the inverse are computed once for an a that is used with many b
+struct congruence_t
+{
+	Big g;
+	Big modul;//m/g
+	Big inv;//(a/g)^-1 mod m/g
+	const residues_mod_t * rezidua;//the numbers mod m/g, 0 when there are too many divisors and the numbers are scanned
+};
+
+//divisors of n with their own residue index, a few powers of small primes shared by the numbers and n in practice
+#define MAX_DIVISORS 64
+
+//everything the curve searches need for one modulus n = cisla[ p ]
+struct curve_modulus_t
+{
+	const number_store_t & cisla;
+	unsigned int p;
+	const Big & n;
+	modulus_context_t ctx;
+	big_hash_t hash;
+	//the numbers reduced mod n
+	residues_mod_t modn;
+	const std::vector<Big> & zbytky;
+	//their squares mod n, the inverses of the squares where they exist
+	std::vector<Big> ctverce;
+	std::vector<Big> inverze;
+	std::vector<bool> invertible;
+	//the numbers mod the divisors of n that the congruences have needed so far, built on demand by the task of n
+	mutable std::vector< std::unique_ptr<residues_mod_t> > delitele;
+	mutable Big d0;
+
+	curve_modulus_t( const number_store_t & c, unsigned int modulus ): cisla( c ), p( modulus ), n( c[ modulus ] ), ctx( c[ modulus ] ),
+		zbytky( modn.zbytky ), ctverce( c.size() ), inverze( c.size() ), invertible( c.size() )
+	{
+		modn.m = n;
+		modn.zbytky.resize( cisla.size() );
+		smycka( i )
+		{
+			ctx.reduce( modn.zbytky[ i ], cisla[ i ] );
+			ctx.mul( ctverce[ i ], zbytky[ i ], zbytky[ i ] );
+			invertible[ i ] = mpz_invert( inverze[ i ].get_mpz_t(), ctverce[ i ].get_mpz_t(), n.get_mpz_t() ) != 0;
+		}
+		modn.build( hash );
+	}
+
+	//the numbers mod m, a divisor of n, 0 when there are already MAX_DIVISORS of them
+	const residues_mod_t * residues( const Big & m ) const
+	{
+		if( m == n )
+			return &modn;
+		for( size_t i = 0; i < delitele.size(); ++i )
+		{
+			if( delitele[ i ]->m == m )
+				return delitele[ i ].get();
+		}
+		if( delitele.size() >= MAX_DIVISORS )
+			return 0;
+
+		std::unique_ptr<residues_mod_t> r( new residues_mod_t );
+		r->m = m;
+		r->zbytky.resize( cisla.size() );
+		smycka( i )
+		{
+			mpz_fdiv_r( r->zbytky[ i ].get_mpz_t(), cisla[ i ].get_mpz_t(), m.get_mpz_t() );
+		}
+		r->build( hash );
+		delitele.push_back( std::move( r ) );
+		return delitele.back().get();
+	}
+
+	//prepares a*d == b (mod m) for many b, m is n or its divisor and a is reduced mod m
+	void congruence( const Big & a, const Big & m, congruence_t & k ) const
+	{
+		mpz_gcd( k.g.get_mpz_t(), a.get_mpz_t(), m.get_mpz_t() );
+		mpz_divexact( k.modul.get_mpz_t(), m.get_mpz_t(), k.g.get_mpz_t() );
+		k.inv = 0;
+		if( k.modul > 1 )
+		{
+			mpz_divexact( k.inv.get_mpz_t(), a.get_mpz_t(), k.g.get_mpz_t() );
+			mpz_invert( k.inv.get_mpz_t(), k.inv.get_mpz_t(), k.modul.get_mpz_t() );
+		}
+		k.rezidua = residues( k.modul );
+	}
+
+	//calls found( i ) for every number i == value (mod r.m), value is reduced
+	template <typename F> void lookup( const residues_mod_t & r, const Big & value, F found ) const
+	{
+		std::pair<residue_index_t::const_iterator, residue_index_t::const_iterator> hits = r.index.equal_range( hash( value ) );
+		for( residue_index_t::const_iterator it = hits.first; it != hits.second; ++it )
+		{
+			if( r.zbytky[ it->second ] == value )
+				found( it->second );
+		}
+	}
+
+	//calls found( i ) for every number i == value (mod n)
+	template <typename F> void lookup( const Big & value, F found ) const
+	{
+		lookup( modn, value, found );
+	}
+
+	//calls found( i ) for every number i with a*i == b (mod m) of the prepared congruence
+	template <typename F> void solve( const congruence_t & k, const Big & b, F found ) const
+	{
+		if( !mpz_divisible_p( b.get_mpz_t(), k.g.get_mpz_t() ) )
+			return;
+		mpz_divexact( d0.get_mpz_t(), b.get_mpz_t(), k.g.get_mpz_t() );
+		d0 *= k.inv;
+		mpz_fdiv_r( d0.get_mpz_t(), d0.get_mpz_t(), k.modul.get_mpz_t() );
+		if( k.rezidua )
+		{
+			lookup( *k.rezidua, d0, found );
+			return;
+		}
+		smycka( i )
+		{
+			if( mpz_congruent_p( cisla[ i ].get_mpz_t(), d0.get_mpz_t(), k.modul.get_mpz_t() ) )
+				found( i );
+		}
+	}
+};
+
+//the curve search holds N^2 terms per modulus and costs O(N^3) in total, longer lists are not searched for curves
+#define MAX_CURVE_NUMBERS 1024
+
+//one tabulated right side x^3 + a*x of the Weierstrass search, the table is sorted by the hash of the value
+struct curve_term_t
+{
+	size_t hash;
+	unsigned int x, a;
+
+	bool operator<( const curve_term_t & o ) const
+	{
+		return hash < o.hash;
+	}
+};
+
+//y^2 - b == x^3 + a*x (mod n): the right side is tabulated over (x, a), the left side over all (y, b) is looked up in it
+void search_weierstrass( const curve_modulus_t & mod, std::vector<curve_finding_t> & found, const task_pool_t & pool )
+{
+	const number_store_t & cisla = mod.cisla;
+	const unsigned int p = mod.p;
+	const Big & n = mod.n;
+
+	//Elliptic wants all of x, y, a, b <= n
+	std::vector<unsigned int> pouzitelna;
+	smycka( i )
+	{
+		if( i != p && cisla[ i ] <= n )
+			pouzitelna.push_back( i );
+	}
+	if( pouzitelna.size() < 4 )
+		return;
+
+	//16 bytes per (x, a), 16 MB for MAX_CURVE_NUMBERS numbers
+	std::vector<curve_term_t> prave;
+	prave.reserve( pouzitelna.size() * pouzitelna.size() );
+	Big kostka, v;
+	for( size_t xi = 0; xi < pouzitelna.size(); ++xi )
+	{
+		const unsigned int x = pouzitelna[ xi ];
+		mod.ctx.mul( kostka, mod.ctverce[ x ], mod.zbytky[ x ] );
+		for( size_t ai = 0; ai < pouzitelna.size(); ++ai )
+		{
+			const unsigned int a = pouzitelna[ ai ];
+			if( a == x ) continue;
+			mod.ctx.mul( v, mod.zbytky[ a ], mod.zbytky[ x ] );
+			v += kostka;
+			if( v >= n )
+				v -= n;
+			curve_term_t term = { mod.hash( v ), x, a };
+			prave.push_back( term );
+		}
+	}
+	std::sort( prave.begin(), prave.end() );
+	if( pool.stopped() )
+		return;
+
+	for( size_t yi = 0; yi < pouzitelna.size(); ++yi )
+	{
+		const unsigned int y = pouzitelna[ yi ];
+		for( size_t bi = 0; bi < pouzitelna.size(); ++bi )
+		{
+			const unsigned int b = pouzitelna[ bi ];
+			if( b == y ) continue;
+			v = mod.ctverce[ y ] - mod.zbytky[ b ];
+			if( v < 0 )
+				v += n;
+
+			const curve_term_t key = { mod.hash( v ), 0, 0 };
+			std::pair<std::vector<curve_term_t>::const_iterator, std::vector<curve_term_t>::const_iterator> hits = std::equal_range( prave.begin(), prave.end(), key );
+			for( std::vector<curve_term_t>::const_iterator it = hits.first; it != hits.second; ++it )
+			{
+				const unsigned int x = it->x;
+				const unsigned int a = it->a;
+				if( x == y || x == b ) continue;
+				if( a == y || a == b ) continue;
+
+				pec_curve_info_t newb = 0;
+				if( Elliptic( cisla[ x ], cisla[ y ], cisla[ a ], cisla[ b ], n, newb ) )
 				{
-					goto end;
+					curve_finding_t f = { x, y, a, b, p, newb, false, 0 };
+					found.push_back( f );
 				}
 			}
 		}
-#pragma omp section 
-		if( cisla_size >= 5 )//mame dost cisel na 5 argumentu
+		if( pool.stopped() )
+			return;
+	}
+}
+
+//x^2 + y^2 == c^2*(1 + d*x^2*y^2) (mod n): d = s/(c^2*t) - 1/t with s = x^2 + y^2 and t = x^2*y^2
+//s/t and 1/t are computed once per unordered (x, y), the equation is symmetric in x and y
+//every c then costs one multiplication and a lookup, the equation does not split into two halves that could be joined
+//when c^2 or t is not invertible, c^2*(1 + t*d) == s is solved as t*d == (s/g)*(c^2/g)^-1 - 1 (mod n/g), g = gcd(c^2, n)
+void search_edwards( const curve_modulus_t & mod, std::vector<curve_finding_t> & found, const task_pool_t & pool )
+{
+	const number_store_t & cisla = mod.cisla;
+	const unsigned int p = mod.p;
+	const Big & n = mod.n;
+	Big s, t, tinv, alfa, u, r;
+
+	//c^2*e == s (mod n) for every c
+	std::vector<congruence_t> ctverce_c( cisla.size() );
+	smycka( c )
+	{
+		mod.congruence( mod.ctverce[ c ], n, ctverce_c[ c ] );
+	}
+	//t*d == r (mod m) for the moduli m of the c met with the current (x, y)
+	std::vector< std::pair<Big, congruence_t> > t_mod;
+
+	smycka( x )
+	{
+		if( x == p ) continue;
+		if( cisla[ x ] == -1 || cisla[ x ] >= n ) continue;
+		for( unsigned int y = x + 1; y < cisla.size(); y++ )
 		{
-			smycka( j )
+			if( y == p ) continue;
+			if( cisla[ y ] == -1 || cisla[ y ] >= n ) continue;
+
+			s = mod.ctverce[ x ] + mod.ctverce[ y ];
+			if( s >= n )
+				s -= n;
+			mod.ctx.mul( t, mod.ctverce[ x ], mod.ctverce[ y ] );
+			const bool t_invertible = mod.invertible[ x ] && mod.invertible[ y ];
+			if( t_invertible )
+			{
+				mod.ctx.mul( tinv, mod.inverze[ x ], mod.inverze[ y ] );
+				mod.ctx.mul( alfa, s, tinv );
+			}
+			t_mod.clear();
+
+			smycka( c )
 			{
-				smycka( k )
+				if( c == p || c == x || c == y ) continue;
+				auto test = [&]( unsigned int d )
 				{
-					if( j == k ) continue;
-					smycka( l )
+					if( d == p || d == x || d == y || d == c ) return;
+					pec_curve_info_t none = 0;
+					if( Edwards( cisla[ x ], cisla[ y ], cisla[ c ], cisla[ d ], n, none ) )
 					{
-						if( l == j ) continue;
-						if( l == k ) continue;
-						smycka( m )
-						{
-							if( m == j ) continue;
-							if( m == k ) continue;
-							if( m == l ) continue;
-							smycka( n )
-							{
-								if( n == j ) continue;
-
-								if( n == k ) continue;
-
-								if( n == l ) continue;
-
-								if( n == m ) continue;
-
-								if( pouzite[ j ] )
-									continue;
-
-								if( pouzite[ k ] )
-									continue;
-
-								pec_curve_info_t newb = 0;
-
-								if( Elliptic( cisla[ j ], cisla[ k ], cisla[ l ], cisla[ m ], cisla[ n ], newb ) )
-								{
-									pouzite[ j ] = true;
-									pouzite[ k ] = true;
-									pouzite[ l ] = true;
-									pouzite[ m ] = true;
-									pouzite[ n ] = true;
-
-									//ecurve( cisla[ l ], cisla[ m ], cisla[ n ], MR_BEST );
-
-									body[ body_size++ ] = newb;
-
-									elliptic_info( cisla[ j ], cisla[ k ], cisla[ l ], cisla[ m ], cisla[ n ] );
-									newb = 0;
-								}
-								if( Edwards( cisla[ j ], cisla[ k ], cisla[ l ], cisla[ m ], cisla[ n ], newb ) )
-								{
-									pouzite[ j ] = true;
-									pouzite[ k ] = true;
-									pouzite[ l ] = true;
-									pouzite[ m ] = true;
-									pouzite[ n ] = true;
-									Edwards_info( cisla[ j ], cisla[ k ], cisla[ l ], cisla[ m ], cisla[ n ] );
-								}
-
-								if( twisted_Edwards( cisla[ j ], cisla[ k ], cisla[ l ], cisla[ m ], cisla[ n ], newb ) )
-								{
-									pouzite[ j ] = true;
-									pouzite[ k ] = true;
-									pouzite[ l ] = true;
-									pouzite[ m ] = true;
-									pouzite[ n ] = true;
-									body[ body_size++ ] = newb;
-									twisted_Edwards_info( cisla[ j ], cisla[ k ], cisla[ l ], cisla[ m ], cisla[ n ] );
-								}
-
-							}
-						}
+						curve_finding_t f = { x, y, c, d, p, 0, true, 0 };
+						found.push_back( f );
 					}
-					if( wasbreak() )
+					if( Edwards( cisla[ y ], cisla[ x ], cisla[ c ], cisla[ d ], n, none ) )
 					{
-						goto end;
+						curve_finding_t f = { y, x, c, d, p, 0, true, 0 };
+						found.push_back( f );
 					}
+				};
+
+				if( t_invertible && mod.invertible[ c ] )
+				{
+					mod.ctx.mul( u, alfa, mod.inverze[ c ] );
+					u -= tinv;
+					if( u < 0 )
+						u += n;
+					mod.lookup( u, test );
+					continue;
+				}
+
+				const congruence_t & kc = ctverce_c[ c ];
+				if( !mpz_divisible_p( s.get_mpz_t(), kc.g.get_mpz_t() ) )
+					continue;
+				mpz_divexact( r.get_mpz_t(), s.get_mpz_t(), kc.g.get_mpz_t() );
+				r *= kc.inv;
+				r -= 1;
+				mpz_fdiv_r( r.get_mpz_t(), r.get_mpz_t(), kc.modul.get_mpz_t() );
+
+				size_t k = 0;
+				while( k < t_mod.size() && t_mod[ k ].first != kc.modul )
+				{
+					++k;
+				}
+				if( k == t_mod.size() )
+				{
+					t_mod.push_back( std::make_pair( kc.modul, congruence_t() ) );
+					mpz_fdiv_r( u.get_mpz_t(), t.get_mpz_t(), kc.modul.get_mpz_t() );
+					mod.congruence( u, kc.modul, t_mod[ k ].second );
 				}
+				mod.solve( t_mod[ k ].second, r, test );
 			}
 		}
+		if( pool.stopped() )
+			return;
 	}
+}
 
-	log_stream << "==================" << std::endl;
-	smycka2( j )
+//a*x^2 + y^2 == 1 + d*x^2*y^2 (mod n): d = a/y^2 + (y^2 - 1)/(x^2*y^2)
+//a/y^2 is tabulated once per y, so every (x, a) costs one addition and a lookup
+//when x^2*y^2 is not invertible, the congruence x^2*y^2 * d == a*x^2 + y^2 - 1 is prepared once per (x, y)
+void search_twisted( const curve_modulus_t & mod, std::vector<curve_finding_t> & found, const task_pool_t & pool )
+{
+	const number_store_t & cisla = mod.cisla;
+	const unsigned int p = mod.p;
+	const Big & n = mod.n;
+	Big t, v, w, u, b;
+	std::vector<Big> podily( cisla.size() );
+	congruence_t kt;
+
+	smycka( y )
 	{
-		smycka2( k )
+		if( y == p ) continue;
+		if( cisla[ y ] == 1 || cisla[ y ] >= n ) continue;
+
+		if( mod.invertible[ y ] )
 		{
-			if( j == k )
-				continue;
-			smycka( i )
+			smycka( a )
 			{
-				if( pouzite[ i ] )
-					continue;
-
-				if( (*body[ j ]) == (*body[ k ]) )//same curve
-				{
-					//body[ j ]->set();
-					//cout << "pt[j]:" << body[j]->pt<<endl;
-					//cout << "pt[k]:" << body[k]->pt<<endl;
-
+				mod.ctx.mul( podily[ a ], mod.zbytky[ a ], mod.inverze[ y ] );
+			}
+		}
+		v = mod.ctverce[ y ] - 1;
+		if( v < 0 )
+			v += n;
 
-					ec_point_t tmp = body[ j ]->curve->times( cisla[ i ], body[ j ]->pt );
+		smycka( x )
+		{
+			if( x == p || x == y ) continue;
+			if( cisla[ x ] == 1 || cisla[ x ] >= n ) continue;
 
+			const bool t_invertible = mod.invertible[ x ] && mod.invertible[ y ];
+			if( t_invertible )
+			{
+				//(y^2 - 1) / (x^2*y^2)
+				mod.ctx.mul( u, mod.inverze[ x ], mod.inverze[ y ] );
+				mod.ctx.mul( w, v, u );
+			}
+			else
+			{
+				mod.ctx.mul( t, mod.ctverce[ x ], mod.ctverce[ y ] );
+				mod.congruence( t, n, kt );
+			}
 
-					if( (tmp.same( body[ k ]->pt )) )
+			smycka( a )
+			{
+				if( a == p || a == x || a == y ) continue;
+				auto test = [&]( unsigned int d )
+				{
+					if( d == p || d == x || d == y || d == a ) return;
+					pec_curve_info_t newb = 0;
+					if( twisted_Edwards( cisla[ x ], cisla[ y ], cisla[ a ], cisla[ d ], n, newb ) )
 					{
-						log_stream << cisla[ i ] << " * [" << body[ j ]->name << "] == [" << body[ k ]->name << "]" << std::endl;
+						curve_finding_t f = { x, y, a, d, p, 0, false, newb };
+						found.push_back( f );
 					}
+				};
+
+				if( t_invertible )
+				{
+					u = podily[ a ] + w;
+					if( u >= n )
+						u -= n;
+					mod.lookup( u, test );
+				}
+				else
+				{
+					mod.ctx.mul( b, mod.zbytky[ a ], mod.ctverce[ x ] );
+					b += v;
+					if( b >= n )
+						b -= n;
+					mod.solve( kt, b, test );
 				}
 			}
 		}
+		if( pool.stopped() )
+			return;
+	}
+}
 
-		smycka( i )
+//the Edwards forms cost a lookup per (x, y, c) and modulus, O(N^4) in total, so they are searched only in short lists
+//128 random 256-bit numbers take about 20 s of one core
+#define MAX_EDWARDS_NUMBERS 128
+
+//the curve points with the modulus cisla[ p ], the used numbers are skipped later, when the findings are merged
+void search_curves( const number_store_t & cisla, unsigned int p, bool edwards, std::vector<curve_finding_t> & found, const task_pool_t & pool )
+{
+	if( cisla[ p ] < 5 )
+		return;
+
+	const curve_modulus_t mod( cisla, p );
+	search_weierstrass( mod, found, pool );
+	if( !edwards )
+		return;
+	search_edwards( mod, found, pool );
+	search_twisted( mod, found, pool );
+}
+
+bool curve_finding_less( const curve_finding_t & a, const curve_finding_t & b )
+{
+	if( a.j != b.j ) return a.j < b.j;
+	if( a.k != b.k ) return a.k < b.k;
+	if( a.l != b.l ) return a.l < b.l;
+	if( a.m != b.m ) return a.m < b.m;
+	return a.n < b.n;
+}
+
+//sorts the findings into the order of the old 5-tuple loops and joins the curves found for the same tuple
+void join_curves( std::vector<curve_finding_t> & found )
+{
+	std::sort( found.begin(), found.end(), curve_finding_less );
+	size_t out = 0;
+	for( size_t i = 0; i < found.size(); ++i )
+	{
+		if( out > 0 && !curve_finding_less( found[ out - 1 ], found[ i ] ) )
 		{
-			if( pouzite[ i ] )
-				continue;
+			curve_finding_t & f = found[ out - 1 ];
+			if( found[ i ].weierstrass )
+				f.weierstrass = found[ i ].weierstrass;
+			if( found[ i ].edwards )
+				f.edwards = true;
+			if( found[ i ].twisted )
+				f.twisted = found[ i ].twisted;
+			continue;
+		}
+		found[ out++ ] = found[ i ];
+	}
+	found.resize( out );
+}
 
+void free_curve( pec_curve_info_t p )
+{
+	if( !p )
+		return;
+	delete p->curve;
+	delete p;
+}
 
-			if( iszero( cisla[ i ] ) )
-				continue;
+//replays the curve findings in the order of the sequential search
+void merge_curves( const number_store_t & cisla, std::vector<curve_finding_t> & found, point_vector_t & body, bool_vector_t & pouzite, std::ostream & log )
+{
+	for( size_t i = 0; i < found.size(); ++i )
+	{
+		curve_finding_t & f = found[ i ];
+		if( pouzite[ f.j ] || pouzite[ f.k ] )
+		{
+			free_curve( f.weierstrass );
+			free_curve( f.twisted );
+			continue;
+		}
+
+		pouzite[ f.j ] = true;
+		pouzite[ f.k ] = true;
+		pouzite[ f.l ] = true;
+		pouzite[ f.m ] = true;
+		pouzite[ f.n ] = true;
 
+		if( f.weierstrass )
+		{
+			f.weierstrass->name = body.size();
+			body.push_back( f.weierstrass );
+			elliptic_info( log, f.weierstrass->name, cisla[ f.j ], cisla[ f.k ], cisla[ f.l ], cisla[ f.m ], cisla[ f.n ] );
+		}
+		if( f.edwards )
+		{
+			Edwards_info( log, cisla[ f.j ], cisla[ f.k ], cisla[ f.l ], cisla[ f.m ], cisla[ f.n ] );
+		}
+		if( f.twisted )
+		{
+			f.twisted->name = body.size();
+			body.push_back( f.twisted );
+			twisted_Edwards_info( log, cisla[ f.j ], cisla[ f.k ], cisla[ f.l ], cisla[ f.m ], cisla[ f.n ] );
+		}
+	}
+}
 
+//every cisla[ i ] * [j] is computed once with the wNAF table of [j], then compared with all points on the same curve
+//all multiples are computed in one batch, so they share a single inversion
+void search_multiples( const number_store_t & cisla, const point_vector_t & body, const bool_vector_t & pouzite, unsigned int j, std::ostream & log )
+{
+	std::vector<mpz_class> skalary;
+	smycka( i )
+	{
+		if( !pouzite[ i ] )
+			skalary.push_back( cisla[ i ] );
+	}
 
-			ec_point_t tmp = body[ j ]->curve->times( cisla[ i ], body[ j ]->pt );
+	ec_table_t table;
+	body[ j ]->curve->precompute( body[ j ]->pt, skalary.size(), table );
 
-			if( tmp.inf )
+	std::vector<ec_point_t> vysledky;
+	body[ j ]->curve->times( skalary, table, vysledky );
+
+	std::vector<ec_point_t> nasobky( cisla.size() );
+	size_t pozice = 0;
+	smycka( i )
+	{
+		if( pouzite[ i ] )
+			continue;
+		nasobky[ i ] = vysledky[ pozice++ ];
+	}
+
+	smycka2( k )
+	{
+		if( j == k )
+			continue;
+		if( !((*body[ j ]) == (*body[ k ])) )//same curve
+			continue;
+		smycka( i )
+		{
+			if( pouzite[ i ] )
+				continue;
+
+			if( (nasobky[ i ].same( body[ k ]->pt )) )
 			{
-				log_stream << cisla[ i ] << " * [" << body[ j ]->name << "] == [inf]" << std::endl;
+				log << cisla[ i ] << " * [" << body[ j ]->name << "] == [" << body[ k ]->name << "]" << std::endl;
 			}
 		}
 	}
-	log_stream << "==================" << std::endl;
+
 	smycka( i )
 	{
-		if( prime( cisla[ i ], 8 ) )
+		if( pouzite[ i ] )
+			continue;
+
+
+		if( iszero( cisla[ i ] ) )
+			continue;
+
+		if( nasobky[ i ].inf )
 		{
-			log_stream << cisla[ i ] << " is prime (" << bits( cisla[ i ] ) << " bits)." << std::endl;
+			log << cisla[ i ] << " * [" << body[ j ]->name << "] == [inf]" << std::endl;
 		}
 	}
+}
 
+#define PRIME_CHUNK 64
+
+std::string guess_relations( number_list_t & numbers )
+{
+	point_vector_t body;
+	const number_store_t cisla( numbers );
+	const unsigned int cisla_size = cisla.size();
+	bool_vector_t pouzite( cisla_size, false );
+	std::stringstream log_stream;
+	task_pool_t pool;
+	bool complete;
+
+	//the tuple space is cut into tasks by the outer indices or by the modulus
+	//the curve findings are sorted back into the order of the old sequential loops before they are merged
+	const size_t fce3_tasks = cisla_size >= 3 ? arraysz( fce3 ) * cisla_size : 0;//mame dost cisel na 3 argumenty
+	const size_t modexp_tasks = cisla_size >= 3 ? cisla_size : 0;
+	const size_t fce4_tasks = cisla_size >= 4 ? cisla_size : 0;
+	const size_t curve_tasks = cisla_size >= 5 && cisla_size <= MAX_CURVE_NUMBERS ? cisla_size : 0;//mame dost cisel na 5 argumentu
+
+	std::vector<findings_t> findings( fce3_tasks + modexp_tasks + fce4_tasks + curve_tasks );
+
+	const bool edwards = cisla_size <= MAX_EDWARDS_NUMBERS;
+	if( cisla_size > MAX_CURVE_NUMBERS )
+	{
+		log_stream << "too many numbers for the curve search (" << cisla_size << " > " << MAX_CURVE_NUMBERS << "), the curves are not searched" << std::endl;
+	}
+	else if( curve_tasks && !edwards )
+	{
+		log_stream << "too many numbers for the Edwards curve search (" << cisla_size << " > " << MAX_EDWARDS_NUMBERS << "), only short Weierstrass curves are searched" << std::endl;
+	}
+
+	complete = pool.run( findings.size(), [&]( size_t t )
+	{
+		std::stringstream log;
+		size_t task = t;
+		if( task < fce3_tasks )
+		{
+			search_fce3( cisla, task / cisla_size, task % cisla_size, log );
+		}
+		else if( (task -= fce3_tasks) < modexp_tasks )
+		{
+			search_modexp( cisla, task, log, pool );
+		}
+		else if( (task -= modexp_tasks) < fce4_tasks )
+		{
+			search_fce4( cisla, task, log, pool );
+		}
+		else
+		{
+			task -= fce4_tasks;
+			search_curves( cisla, task, edwards, findings[ t ].curves, pool );
+		}
+		findings[ t ].log = log.str();
+	}, wasbreak );
+
+	std::vector<curve_finding_t> curves;
+	for( size_t t = 0; t < findings.size(); ++t )
+	{
+		log_stream << findings[ t ].log;
+		curves.insert( curves.end(), findings[ t ].curves.begin(), findings[ t ].curves.end() );
+	}
+	join_curves( curves );
+	merge_curves( cisla, curves, body, pouzite, log_stream );
+
+	if( complete )
+	{
+		log_stream << "==================" << std::endl;
+
+		std::vector<std::string> multiples( body.size() );
+		complete = pool.run( body.size(), [&]( size_t j )
+		{
+			std::stringstream log;
+			search_multiples( cisla, body, pouzite, j, log );
+			multiples[ j ] = log.str();
+		}, wasbreak );
+
+		smycka2( j )
+		{
+			log_stream << multiples[ j ];
+		}
+	}
+
+	if( complete )
+	{
+		log_stream << "==================" << std::endl;
+
+		std::vector<std::string> primes( (cisla_size + PRIME_CHUNK - 1) / PRIME_CHUNK );
+		pool.run( primes.size(), [&]( size_t chunk )
+		{
+			std::stringstream log;
+			for( unsigned int i = chunk * PRIME_CHUNK; i < cisla_size && i < (chunk + 1) * PRIME_CHUNK; ++i )
+			{
+				if( prime( cisla[ i ], 8 ) )
+				{
+					log << cisla[ i ] << " is prime (" << bits( cisla[ i ] ) << " bits)." << std::endl;
+				}
+			}
+			primes[ chunk ] = log.str();
+		}, wasbreak );
+
+		for( size_t i = 0; i < primes.size(); ++i )
+		{
+			log_stream << primes[ i ];
+		}
+	}
 
-end:
 	std::string str;
 	str = log_stream.str();
 
 	smycka2( j )
 	{
-		delete body[ j ];
+		free_curve( body[ j ] );
 	}
 	return str;
 }
\ No newline at end of file
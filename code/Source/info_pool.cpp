@@ -0,0 +1,150 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#include "info_pool.h"
+
+info_pool_t::info_pool_t( size_t max_text, unsigned int threads ): max_text( max_text ), nthreads( threads ), stop( false )
+{
+	//one core is left to IDA
+	if( nthreads == 0 )
+		nthreads = std::thread::hardware_concurrency() - 1;
+	if( nthreads == 0 )
+		nthreads = 1;
+	if( nthreads > 64 )
+		nthreads = 64;
+}
+
+info_pool_t::~info_pool_t()
+{
+	shutdown();
+}
+
+void info_pool_t::submit( unsigned int serial, const mpz_class & number )
+{
+	std::lock_guard<std::mutex> guard( lock );
+	if( workers.empty() )
+	{
+		stop = false;
+		for( unsigned int i = 0; i < nthreads; ++i )
+		{
+			workers.push_back( std::thread( &info_pool_t::worker, this ) );
+		}
+	}
+	job_t job;
+	job.serial = serial;
+	job.number = number;
+	jobs.push_back( job );
+	wake.notify_one();
+}
+
+bool info_pool_t::collect( std::vector<number_columns_t> & results )
+{
+	results.clear();
+	std::lock_guard<std::mutex> guard( lock );
+	results.swap( finished );
+	return !results.empty();
+}
+
+void info_pool_t::clear()
+{
+	std::lock_guard<std::mutex> guard( lock );
+	jobs.clear();
+	finished.clear();
+}
+
+void info_pool_t::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> guard( lock );
+		stop = true;
+		jobs.clear();
+		wake.notify_all();
+	}
+	for( size_t i = 0; i < workers.size(); ++i )
+	{
+		workers[ i ].join();
+	}
+	workers.clear();
+}
+
+bool info_pool_t::stopping()
+{
+	std::lock_guard<std::mutex> guard( lock );
+	return stop;
+}
+
+//the leading max_text hex digits, only the top limbs are converted
+static std::string leading_hex( const mpz_class & number, size_t max_text )
+{
+	const size_t digits = mpz_sizeinbase( number.get_mpz_t(), 16 );
+	if( digits <= max_text )
+		return number.get_str( 16 );
+	mpz_class top;
+	mpz_tdiv_q_2exp( top.get_mpz_t(), number.get_mpz_t(), 4 * (digits - max_text) );
+	return top.get_str( 16 );
+}
+
+void info_pool_t::worker()
+{
+	std::unique_lock<std::mutex> guard( lock );
+	for( ;; )
+	{
+		while( !stop && jobs.empty() )
+		{
+			wake.wait( guard );
+		}
+		if( stop )
+			return;
+
+		job_t job;
+		job.serial = jobs.front().serial;
+		job.number.swap( jobs.front().number );
+		jobs.pop_front();
+		guard.unlock();
+
+		//shutdown waits for the running jobs, so they give up between the stages
+		const size_t bits = mpz_sizeinbase( job.number.get_mpz_t(), 2 );
+		number_columns_t columns;
+		columns.serial = job.serial;
+		columns.hex = leading_hex( job.number, max_text );
+		if( bits <= INFO_MAX_DEC_BITS )
+		{
+			columns.dec = job.number.get_str( 10 );
+			if( columns.dec.size() > max_text )
+				columns.dec.resize( max_text );
+		}
+		else
+		{
+			columns.dec = "too big for decimal";
+		}
+		columns.tested = bits <= INFO_MAX_PRIME_BITS && !stopping();
+		columns.prime = columns.tested && mpz_probab_prime_p( job.number.get_mpz_t(), 8 ) != 0;
+
+		guard.lock();
+		if( stop )
+			return;
+		finished.push_back( columns );
+	}
+}
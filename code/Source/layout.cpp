@@ -0,0 +1,114 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#include <algorithm>
+#include "layout.h"
+
+//3 * 5 * ... * 53, a gcd with it divides by all of them at once
+#define SMALL_PRIMES_PRODUCT 16294579238595022365ull
+#define TRIAL_DIVISION_LIMIT 1000
+
+//trial division throws away most composites before the probabilistic test
+static bool probable_prime( const mpz_class & n )
+{
+	if( n < TRIAL_DIVISION_LIMIT )
+		return mpz_probab_prime_p( n.get_mpz_t(), 2 ) != 0;
+	if( mpz_even_p( n.get_mpz_t() ) )
+		return false;
+	//unsigned long is only 32 bits wide on windows
+	static const unsigned long long product[] = { SMALL_PRIMES_PRODUCT };
+	mpz_class primorial;
+	mpz_import( primorial.get_mpz_t(), 1, 1, sizeof( product[ 0 ] ), 0, 0, product );
+	mpz_class g;
+	mpz_gcd( g.get_mpz_t(), n.get_mpz_t(), primorial.get_mpz_t() );
+	if( g != 1 )
+		return false;
+	for( unsigned long d = 59; d < TRIAL_DIVISION_LIMIT; d += 2 )
+	{
+		if( mpz_divisible_ui_p( n.get_mpz_t(), d ) )
+			return false;
+	}
+	return mpz_probab_prime_p( n.get_mpz_t(), 2 ) != 0;
+}
+
+bool guess_layouts( const unsigned char * bytes, size_t size, const std::function<bool( const mpz_class & )> & known, std::vector<layout_guess_t> & guesses,
+	bool( *interrupted )(void) )
+{
+	guesses.clear();
+	static const int word_sizes[] = { 1, 2, 4, 8 };
+	static const int endians[] = { -1, 1 };
+	for( size_t w = 0; w < sizeof( word_sizes ) / sizeof( *word_sizes ); ++w )
+	{
+		const layout_t base = { word_sizes[ w ], 0, 0 };
+		if( size == 0 || size % base.word_size )
+			continue;
+		for( size_t we = 0; we < 2; ++we )
+		{
+			for( size_t be = 0; be < 2; ++be )
+			{
+				layout_t layout = base;
+				layout.word_endian = endians[ we ];
+				layout.bignum_endian = endians[ be ];
+
+				mpz_class number;
+				mpz_import( number.get_mpz_t(), size / layout.word_size, layout.bignum_endian, layout.word_size, layout.word_endian, 0, bytes );
+
+				size_t g = 0;
+				while( g < guesses.size() && guesses[ g ].number != number )
+				{
+					++g;
+				}
+				if( g == guesses.size() )
+				{
+					guesses.push_back( layout_guess_t() );
+					guesses.back().number.swap( number );
+					guesses.back().signals = 0;
+				}
+				guesses[ g ].layouts.push_back( layout );
+			}
+		}
+	}
+
+	for( size_t g = 0; g < guesses.size(); ++g )
+	{
+		if( interrupted() )
+			return false;
+		const mpz_class & n = guesses[ g ].number;
+		unsigned int & signals = guesses[ g ].signals;
+		if( known( n ) )
+			signals |= LAYOUT_KNOWN;
+		if( mpz_odd_p( n.get_mpz_t() ) )
+			signals |= LAYOUT_ODD;
+		//the most significant byte uses its top bit, the number fills the whole region
+		const size_t bits = mpz_sizeinbase( n.get_mpz_t(), 2 );
+		if( n != 0 && bits == size * 8 )
+			signals |= LAYOUT_TOP_BIT;
+		if( bits <= LAYOUT_MAX_PRIME_BITS && probable_prime( n ) )
+			signals |= LAYOUT_PRIME;
+	}
+
+	std::stable_sort( guesses.begin(), guesses.end(), []( const layout_guess_t & a, const layout_guess_t & b ) { return a.signals > b.signals; } );
+	return true;
+}
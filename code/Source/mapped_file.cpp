@@ -0,0 +1,110 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#include "mapped_file.h"
+#ifdef __NT__
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+mapped_file_t::mapped_file_t(): view( NULL ), length( 0 ),
+#ifdef __NT__
+file( INVALID_HANDLE_VALUE ), mapping( NULL )
+#else
+file( -1 )
+#endif
+{
+}
+
+mapped_file_t::~mapped_file_t()
+{
+	close();
+}
+
+void mapped_file_t::close()
+{
+#ifdef __NT__
+	if( view )
+		UnmapViewOfFile( view );
+	if( mapping )
+		CloseHandle( mapping );
+	if( file != INVALID_HANDLE_VALUE )
+		CloseHandle( file );
+	mapping = NULL;
+	file = INVALID_HANDLE_VALUE;
+#else
+	if( view )
+		munmap( (void *)view, length );
+	if( file != -1 )
+		::close( file );
+	file = -1;
+#endif
+	view = NULL;
+	length = 0;
+}
+
+bool mapped_file_t::open( const char * path )
+{
+	close();
+#ifdef __NT__
+	file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if( file == INVALID_HANDLE_VALUE )
+		return false;
+	LARGE_INTEGER file_size;
+	if( !GetFileSizeEx( file, &file_size ) || file_size.QuadPart == 0 || (unsigned long long)file_size.QuadPart > (size_t)-1 )
+	{
+		close();
+		return false;
+	}
+	length = (size_t)file_size.QuadPart;
+	mapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+	if( mapping )
+		view = (const unsigned char *)MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+#else
+	file = ::open( path, O_RDONLY );
+	if( file == -1 )
+		return false;
+	struct stat st;
+	if( fstat( file, &st ) != 0 || st.st_size == 0 )
+	{
+		close();
+		return false;
+	}
+	length = st.st_size;
+	void * p = mmap( NULL, length, PROT_READ, MAP_PRIVATE, file, 0 );
+	if( p != MAP_FAILED )
+		view = (const unsigned char *)p;
+#endif
+	if( !view )
+	{
+		close();
+		return false;
+	}
+	return true;
+}
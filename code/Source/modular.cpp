@@ -0,0 +1,215 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#include "modular.h"
+#include "field.h"
+
+//below this size mpz_tdiv_r is as fast as the Barrett reduction
+#define BARRETT_MIN_BITS 1024
+//the widest window, the table has 2^w - 1 entries per window
+#define MAX_WINDOW 8
+//memory limit of one table, every worker of the pool may hold one
+#define MAX_TABLE_BYTES (8 << 20)
+
+modulus_context_t::modulus_context_t( const mpz_class & modulus ): n( modulus )
+{
+	nbits = mpz_sizeinbase( n.get_mpz_t(), 2 );
+	if( nbits >= BARRETT_MIN_BITS )
+	{
+		mpz_setbit( mu.get_mpz_t(), 2 * nbits );
+		mpz_fdiv_q( mu.get_mpz_t(), mu.get_mpz_t(), n.get_mpz_t() );
+	}
+}
+
+void modulus_context_t::mul( mpz_class & r, const mpz_class & a, const mpz_class & b ) const
+{
+	mpz_mul( r.get_mpz_t(), a.get_mpz_t(), b.get_mpz_t() );
+	if( nbits < BARRETT_MIN_BITS )
+	{
+		mpz_tdiv_r( r.get_mpz_t(), r.get_mpz_t(), n.get_mpz_t() );
+		return;
+	}
+
+	//a*b < 2^(2*nbits), so the estimate of the quotient is at most 2 too small
+	mpz_class q;
+	mpz_tdiv_q_2exp( q.get_mpz_t(), r.get_mpz_t(), nbits - 1 );
+	q *= mu;
+	mpz_tdiv_q_2exp( q.get_mpz_t(), q.get_mpz_t(), nbits + 1 );
+	mpz_submul( r.get_mpz_t(), q.get_mpz_t(), n.get_mpz_t() );
+	while( r >= n )
+	{
+		r -= n;
+	}
+}
+
+void modulus_context_t::reduce( mpz_class & r, const mpz_class & a ) const
+{
+	mpz_fdiv_r( r.get_mpz_t(), a.get_mpz_t(), n.get_mpz_t() );
+}
+
+void modulus_context_t::pow( mpz_class & r, const mpz_class & base, const mpz_class & exp ) const
+{
+	mpz_powm( r.get_mpz_t(), base.get_mpz_t(), exp.get_mpz_t(), n.get_mpz_t() );
+}
+
+//w bits of the exponent starting at bit
+static unsigned int window_digit( const mpz_class & e, size_t bit, unsigned int w )
+{
+	const size_t limb = bit / GMP_NUMB_BITS;
+	const size_t shift = bit % GMP_NUMB_BITS;
+	mp_limb_t v = mpz_getlimbn( e.get_mpz_t(), limb ) >> shift;
+	if( shift + w > GMP_NUMB_BITS )
+		v |= mpz_getlimbn( e.get_mpz_t(), limb + 1 ) << (GMP_NUMB_BITS - shift);
+	return (unsigned int)(v & ((1u << w) - 1));
+}
+
+class powm_kernel_t
+{
+public:
+	virtual ~powm_kernel_t()
+	{
+	}
+
+	//exp is nonnegative and shorter than windows*w bits
+	virtual void pow( mpz_class & r, const mpz_class & exp ) const = 0;
+};
+
+template <typename F> class powm_kernel: public powm_kernel_t
+{
+public:
+	powm_kernel( const F & field, const mpz_class & base, unsigned int width, size_t count ): f( field ), w( width ), windows( count )
+	{
+		const size_t digits = (1u << w) - 1;
+		table.resize( windows * digits );
+
+		//row i holds base^(v * 2^(w*i)) for v = 1..2^w-1
+		typename F::value_t g;
+		f.set( g, base );
+		for( size_t i = 0; i < windows; ++i )
+		{
+			typename F::value_t * row = &table[ i * digits ];
+			row[ 0 ] = g;
+			for( size_t v = 1; v < digits; ++v )
+			{
+				f.mul( row[ v ], row[ v - 1 ], g );
+			}
+			if( i + 1 < windows )
+			{
+				//g^(2^w) = g^(2^w - 1) * g
+				f.mul( g, row[ digits - 1 ], g );
+			}
+		}
+	}
+
+	virtual void pow( mpz_class & r, const mpz_class & exp ) const
+	{
+		const size_t digits = (1u << w) - 1;
+		typename F::value_t acc;
+		bool first = true;
+		for( size_t i = 0; i < windows; ++i )
+		{
+			const unsigned int v = window_digit( exp, i * w, w );
+			if( v == 0 )
+				continue;
+			if( first )
+			{
+				acc = table[ i * digits + v - 1 ];
+				first = false;
+			}
+			else
+			{
+				f.mul( acc, acc, table[ i * digits + v - 1 ] );
+			}
+		}
+		if( first )
+		{
+			//exp == 0
+			f.set( acc, 1 );
+		}
+		r = f.get( acc );
+	}
+
+private:
+	F f;
+	unsigned int w;
+	size_t windows;
+	std::vector<typename F::value_t> table;
+};
+
+struct powm_kernel_build_t
+{
+	typedef powm_kernel_t * result_t;
+
+	const mpz_class & base;
+	unsigned int w;
+	size_t windows;
+
+	template <typename F> powm_kernel_t * run( const F & f )
+	{
+		return new powm_kernel<F>( f, base, w, windows );
+	}
+};
+
+powm_table_t::powm_table_t( const modulus_context_t & context, const mpz_class & b, size_t uses ): ctx( context ), w( 0 ), windows( 0 )
+{
+	ctx.reduce( base, b );
+
+	//costs in modular multiplications, mpz_powm needs about 2/3 of one per exponent bit
+	const size_t nbits = ctx.bits();
+	size_t best = uses * nbits * 2 / 3;
+	for( unsigned int v = 1; v <= MAX_WINDOW; ++v )
+	{
+		const size_t count = (nbits + v - 1) / v;
+		const size_t entries = count * ((1u << v) - 1);
+		if( entries * (nbits / 8 + 1) > MAX_TABLE_BYTES )
+			break;
+		const size_t cost = count * ((1u << v) - 1) + uses * count;
+		if( cost < best )
+		{
+			best = cost;
+			w = v;
+		}
+	}
+	if( w == 0 )
+		return;
+
+	windows = (nbits + w - 1) / w;
+	powm_kernel_build_t job = { base, w, windows };
+	kernel.reset( with_field( ctx.modulus(), job ) );
+}
+
+powm_table_t::~powm_table_t()
+{
+}
+
+void powm_table_t::pow( mpz_class & r, const mpz_class & exp ) const
+{
+	if( w == 0 || sgn( exp ) < 0 || mpz_sizeinbase( exp.get_mpz_t(), 2 ) > windows * w )
+	{
+		ctx.pow( r, base, exp );
+		return;
+	}
+	kernel->pow( r, exp );
+}
@@ -0,0 +1,144 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#include <cstring>
+#include <pro.h>
+#include <fpro.h>
+#include "number_file.h"
+
+#define LIMB_SIZE 8
+
+static uint64 limb_count( const mpz_class & number )
+{
+	if( number == 0 )
+		return 0;
+	return (mpz_sizeinbase( number.get_mpz_t(), 2 ) + 8 * LIMB_SIZE - 1) / (8 * LIMB_SIZE);
+}
+
+bool save_number_file( const char * path, const std::vector<mpz_class> & numbers, const std::vector<ea_t> & addresses, const std::vector<uint32> & hits, const unsigned char input_md5[ 16 ] )
+{
+	FILE * f = fopenWB( path );
+	if( !f )
+		return false;
+
+	number_file_header_t header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, NUMBER_FILE_MAGIC, sizeof( NUMBER_FILE_MAGIC ) );
+	header.version = NUMBER_FILE_VERSION;
+	header.count = numbers.size();
+	memcpy( header.input_md5, input_md5, sizeof( header.input_md5 ) );
+
+	//the header is 32 bytes and an entry 32 bytes, so the limbs start aligned
+	std::vector<number_file_entry_t> index( numbers.size() );
+	uint64 offset = sizeof( header ) + index.size() * sizeof( number_file_entry_t );
+	for( size_t i = 0; i < numbers.size(); ++i )
+	{
+		index[ i ].offset = offset;
+		index[ i ].limbs = limb_count( numbers[ i ] );
+		index[ i ].sign = sgn( numbers[ i ] );
+		index[ i ].hits = hits[ i ];
+		index[ i ].address = addresses[ i ] == BADADDR ? ~(uint64)0 : (uint64)addresses[ i ];
+		offset += index[ i ].limbs * LIMB_SIZE;
+	}
+
+	bool ok = qfwrite( f, &header, sizeof( header ) ) == (ssize_t)sizeof( header );
+	if( ok && !index.empty() )
+		ok = qfwrite( f, &index[ 0 ], index.size() * sizeof( number_file_entry_t ) ) == (ssize_t)(index.size() * sizeof( number_file_entry_t ));
+
+	std::vector<unsigned char> limbs;
+	for( size_t i = 0; ok && i < numbers.size(); ++i )
+	{
+		if( !index[ i ].limbs )
+			continue;
+		limbs.resize( index[ i ].limbs * LIMB_SIZE );
+		size_t written = 0;
+		mpz_export( &limbs[ 0 ], &written, -1, LIMB_SIZE, -1, 0, numbers[ i ].get_mpz_t() );
+		ok = qfwrite( f, &limbs[ 0 ], limbs.size() ) == (ssize_t)limbs.size();
+	}
+
+	if( qfclose( f ) != 0 )
+		ok = false;
+	return ok;
+}
+
+void number_file_t::close()
+{
+	file.close();
+	valid = false;
+}
+
+bool number_file_t::is_number_file( const char * path )
+{
+	char magic[ sizeof( NUMBER_FILE_MAGIC ) ] = { 0 };
+	FILE * f = fopenRB( path );
+	if( !f )
+		return false;
+	const bool ok = qfread( f, magic, sizeof( magic ) ) == (ssize_t)sizeof( magic ) && memcmp( magic, NUMBER_FILE_MAGIC, sizeof( magic ) ) == 0;
+	qfclose( f );
+	return ok;
+}
+
+bool number_file_t::open( const char * path )
+{
+	close();
+	if( !file.open( path ) || file.size() < sizeof( number_file_header_t ) )
+	{
+		close();
+		return false;
+	}
+	const unsigned char * view = file.data();
+	const size_t length = file.size();
+
+	//everything get() touches is checked here, so a damaged file is refused as a whole
+	const number_file_header_t & h = header();
+	bool ok = memcmp( h.magic, NUMBER_FILE_MAGIC, sizeof( h.magic ) ) == 0 && h.version == NUMBER_FILE_VERSION;
+	ok = ok && h.count <= (length - sizeof( h )) / sizeof( number_file_entry_t );
+	const number_file_entry_t * index = (const number_file_entry_t *)(view + sizeof( h ));
+	const uint64 data = sizeof( h ) + (uint64)h.count * sizeof( number_file_entry_t );
+	for( uint32 i = 0; ok && i < h.count; ++i )
+	{
+		const number_file_entry_t & e = index[ i ];
+		ok = e.offset >= data && e.offset <= length && e.limbs <= (length - e.offset) / LIMB_SIZE
+			&& (e.sign == 0 ? e.limbs == 0 : (e.sign == 1 || e.sign == -1) && e.limbs != 0);
+	}
+	if( !ok )
+		close();
+	valid = ok;
+	return ok;
+}
+
+void number_file_t::get( size_t i, mpz_class & number, ea_t & address, uint32 & hits ) const
+{
+	const unsigned char * view = file.data();
+	const number_file_entry_t & e = ((const number_file_entry_t *)(view + sizeof( number_file_header_t )))[ i ];
+	if( e.limbs )
+		mpz_import( number.get_mpz_t(), (size_t)e.limbs, -1, LIMB_SIZE, -1, 0, view + e.offset );
+	else
+		number = 0;
+	if( e.sign < 0 )
+		number = -number;
+	address = e.address == ~(uint64)0 ? BADADDR : (ea_t)e.address;
+	hits = e.hits ? e.hits : 1;
+}
@@ -0,0 +1,428 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#include <mpir.h>
+#include <mpirxx.h>
+#include <algorithm>
+#include <vector>
+#include <string>
+
+#include <ida.hpp>
+#include <idp.hpp>
+#include <bytes.hpp>
+#include <segment.hpp>
+
+#include "dumper.h"
+#include "task_pool.h"
+#include "der.h"
+#include "scanner.h"
+
+//shorter candidates are too common to be interesting
+#define SCAN_MIN_BYTES 16
+#define SCAN_MIN_LIMBS 4
+#define SCAN_MIN_DIGITS 32
+//strings of base58 and base64 are mostly identifiers, so they need at least 256 bits and random looking digits
+#define SCAN_MIN_CODED 43
+//base_idx of base58
+#define SCAN_FIRST_CODED 5
+//the same limit as in guess_template
+#define SCAN_MAX_LIMBS 2000
+//one task of the pool, the candidates may reach past its end into the rest of the segment
+#define SCAN_CHUNK (1 << 20)
+#define SCAN_PAGE 0x10000
+//how many gmp candidates are read between the checks for cancel
+#define SCAN_BREAK_POLL 256
+//the list is not useful beyond this
+#define MAX_SCAN_HITS 100000
+
+//indices into presets
+#define SCAN_GMP_PRESET 1
+#define SCAN_BER_PRESET 2
+#define SCAN_TEXT_PRESET( base_idx ) ((base_idx) + 2)
+
+struct segment_range_t
+{
+	ea_t start;
+	ea_t end;
+	//the limbs of a gmp struct are allocated, they never lie in code or imports
+	bool data;
+};
+
+//a gmp struct, its limbs may lie in another segment, so they are read after the workers finish
+struct gmp_candidate_t
+{
+	ea_t address;
+	ea_t limbs;
+	uint32 size;
+};
+
+//the findings of one task
+struct scan_chunk_t
+{
+	std::vector<scan_hit_t> hits;
+	std::vector<gmp_candidate_t> gmps;
+	//big INTEGERs that are kept only when another INTEGER ends where they start
+	std::vector<scan_hit_t> loose;
+	//where every INTEGER ends, of any size
+	std::vector<ea_t> ends;
+};
+
+static bool hit_less( const scan_hit_t & a, const scan_hit_t & b )
+{
+	return a.address < b.address;
+}
+
+static uint32 read_le32( const unsigned char * p )
+{
+	return p[ 0 ] | (p[ 1 ] << 8) | (p[ 2 ] << 16) | ((uint32)p[ 3 ] << 24);
+}
+
+//the segment that contains ea, NULL when there is none
+static const segment_range_t * find_range( const std::vector<segment_range_t> & ranges, ea_t ea )
+{
+	size_t lo = 0;
+	size_t hi = ranges.size();
+	while( lo < hi )
+	{
+		const size_t mid = (lo + hi) / 2;
+		if( ranges[ mid ].end <= ea )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if( lo < ranges.size() && ranges[ lo ].start <= ea )
+		return &ranges[ lo ];
+	return NULL;
+}
+
+static bool idaapi has_value( flags_t flags, void * )
+{
+	return hasValue( flags );
+}
+
+static bool idaapi has_no_value( flags_t flags, void * )
+{
+	return !hasValue( flags );
+}
+
+//bytes that are not loaded are zeros, which start no candidate
+//the holes are skipped at once instead of byte by byte, false when the user cancelled
+static bool snapshot( const segment_range_t & range, std::vector<unsigned char> & data )
+{
+	data.assign( range.end - range.start, 0 );
+	ea_t ea = range.start;
+	while( ea < range.end )
+	{
+		if( wasbreak() )
+			return false;
+		if( !isLoaded( ea ) )
+		{
+			ea = nextthat( ea, range.end, has_value, NULL );
+			if( ea == BADADDR )
+				break;
+			continue;
+		}
+		ea_t end = range.end - ea > SCAN_PAGE ? ea + SCAN_PAGE : range.end;
+		unsigned char * p = &data[ ea - range.start ];
+		if( !get_many_bytes( ea, p, end - ea ) )
+		{
+			//the loaded bytes up to the next hole
+			const ea_t hole = nextthat( ea, end, has_no_value, NULL );
+			if( hole != BADADDR )
+				end = hole;
+			if( !get_many_bytes( ea, p, end - ea ) )
+				memset( p, 0, end - ea );
+		}
+		ea = end;
+	}
+	return true;
+}
+
+static int char_class( unsigned char c )
+{
+	if( c >= '0' && c <= '9' )
+		return 0;
+	if( c >= 'A' && c <= 'Z' )
+		return 1;
+	if( c >= 'a' && c <= 'z' )
+		return 2;
+	return 3;
+}
+
+//identifiers and mangled names use the base58 and base64 alphabets too, but random digits change between
+//a digit, a capital and a small letter at least every third character and seldom form words of small letters
+static bool looks_random( const unsigned char * text, size_t len )
+{
+	size_t changes = 0;
+	size_t in_words = 0;
+	size_t run = 0;
+	for( size_t i = 0; i < len; ++i )
+	{
+		if( i > 0 && char_class( text[ i - 1 ] ) != char_class( text[ i ] ) )
+			++changes;
+		if( char_class( text[ i ] ) == 2 )
+		{
+			++run;
+			continue;
+		}
+		if( run >= 4 )
+			in_words += run;
+		run = 0;
+	}
+	if( run >= 4 )
+		in_words += run;
+	return 3 * changes >= len && 3 * in_words <= len;
+}
+
+//a run of the digits of base_idx that is worth reporting, the base64 padding may only end it
+static bool text_hit( const unsigned char * text, size_t len, int base_idx )
+{
+	if( base_idx < SCAN_FIRST_CODED )
+		return len >= SCAN_MIN_DIGITS;
+	size_t digits = len;
+	while( digits > 0 && len - digits < 2 && text[ digits - 1 ] == '=' )
+	{
+		--digits;
+	}
+	if( digits != len && len % 4 )
+		return false;
+	if( std::find( text, text + digits, '=' ) != text + digits )
+		return false;
+	return digits >= SCAN_MIN_CODED && looks_random( text, digits );
+}
+
+//DER INTEGER at i, BER_int_length/BER_int_offset accept also the longer encodings
+static bool scan_ber( const unsigned char * data, size_t size, size_t i, size_t & offset, size_t & len )
+{
+	der_tlv_t tlv;
+	if( data[ i ] != DER_INTEGER || !der_read_tlv( data, size, i, tlv ) || tlv.length == 0 )
+		return false;
+	//the shortest length
+	if( tlv.offset - i > 2 && (tlv.length < 0x80 || data[ i + 2 ] == 0) )
+		return false;
+	//no superfluous leading zero
+	if( tlv.length > 1 && data[ tlv.offset ] == 0 && !(data[ tlv.offset + 1 ] & 0x80) )
+		return false;
+	offset = tlv.offset;
+	len = tlv.length;
+	return true;
+}
+
+//a SEQUENCE header right before i that covers everything up to end
+static bool first_in_sequence( const unsigned char * data, size_t i, size_t end )
+{
+	if( i >= 2 && data[ i - 2 ] == 0x30 && data[ i - 1 ] < 0x80 )
+		return i + data[ i - 1 ] >= end;
+	for( size_t k = 1; k <= 3; ++k )
+	{
+		if( i < k + 2 || data[ i - k - 2 ] != 0x30 || data[ i - k - 1 ] != 0x80 + k )
+			continue;
+		size_t len = 0;
+		for( size_t j = k; j > 0; --j )
+		{
+			len = (len << 8) | data[ i - j ];
+		}
+		return i + len >= end;
+	}
+	return false;
+}
+
+static void scan_chunk( const std::vector<unsigned char> & segment, ea_t start, size_t from, size_t to,
+	const std::vector<segment_range_t> & ranges, scan_chunk_t & found )
+{
+	const unsigned char * data = &segment[ 0 ];
+	const size_t size = segment.size();
+
+	//BER, the tag 02 with a length is too common in code, so a big INTEGER is kept only when it is the first one
+	//in a SEQUENCE or when it is next to another INTEGER, like the members of the keys are
+	for( size_t i = from; i < to; ++i )
+	{
+		size_t offset, len;
+		if( !scan_ber( data, size, i, offset, len ) )
+			continue;
+		const size_t end = offset + len;
+		found.ends.push_back( start + end );
+		if( len < SCAN_MIN_BYTES )
+			continue;
+
+		scan_hit_t hit;
+		hit.address = start + i;
+		hit.preset = SCAN_BER_PRESET;
+		mpz_import( hit.number.get_mpz_t(), len, 1, 1, 1, 0, data + offset );
+		if( hit.number == 0 )
+			continue;
+		size_t next_offset, next_len;
+		if( first_in_sequence( data, i, end ) || scan_ber( data, size, end, next_offset, next_len ) )
+			found.hits.push_back( hit );
+		else
+			found.loose.push_back( hit );
+	}
+
+	//gmp 32 bit structs: alloc, size, pointer to the limbs
+	for( size_t i = from + (4 - (start + from) % 4) % 4; i < to && i + 12 <= size; i += 4 )
+	{
+		const uint32 alloc = read_le32( data + i );
+		const uint32 limbs = read_le32( data + i + 4 );
+		if( limbs < SCAN_MIN_LIMBS || alloc < limbs || alloc >= SCAN_MAX_LIMBS )
+			continue;
+		const ea_t pointer = read_le32( data + i + 8 );
+		const segment_range_t * range = find_range( ranges, pointer );
+		if( !range || !range->data || pointer % 4 || (uint64)pointer + 4 * limbs > range->end )
+			continue;
+		//a normalised mpz has a nonzero top limb, it can be checked here when the limbs lie in this segment
+		const ea_t top = pointer + 4 * (limbs - 1);
+		if( top >= start && top - start + 4 <= size && read_le32( data + (top - start) ) == 0 )
+			continue;
+		const gmp_candidate_t c = { start + i, pointer, limbs };
+		found.gmps.push_back( c );
+	}
+
+	//\0 terminated strings of one alphabet, a run that started in the previous chunk belongs to it
+	size_t i = from;
+	while( i > 0 && i < to && alphabet_masks[ data[ i - 1 ] ] )
+	{
+		++i;
+	}
+	while( i < to )
+	{
+		if( !alphabet_masks[ data[ i ] ] )
+		{
+			++i;
+			continue;
+		}
+		size_t end = i;
+		while( end < size && alphabet_masks[ data[ end ] ] )
+		{
+			++end;
+		}
+		const unsigned int mask = classify_text( data + i, end - i );
+		if( mask && end - i >= SCAN_MIN_DIGITS && end < size && data[ end ] == 0 )
+		{
+			//the smallest alphabet, as guess_template ranks them
+			int base_idx = 1;
+			while( !(mask & (1 << (base_idx - 1))) )
+			{
+				++base_idx;
+			}
+			if( text_hit( data + i, end - i, base_idx ) )
+			{
+				scan_hit_t hit;
+				hit.address = start + i;
+				hit.preset = SCAN_TEXT_PRESET( base_idx );
+				text_to_number( data + i, end - i, base_idx, 1, hit.number );
+				if( hit.number != 0 )
+					found.hits.push_back( hit );
+			}
+		}
+		i = end;
+	}
+
+	std::stable_sort( found.hits.begin(), found.hits.end(), hit_less );
+}
+
+bool scan_database( std::vector<scan_hit_t> & hits )
+{
+	hits.clear();
+	std::vector<segment_range_t> ranges;
+	for( int i = 0; i < get_segm_qty(); ++i )
+	{
+		const segment_t * s = getnseg( i );
+		if( !s || s->endEA <= s->startEA )
+			continue;
+		const segment_range_t r = { s->startEA, s->endEA, s->type == SEG_DATA || s->type == SEG_BSS };
+		ranges.push_back( r );
+	}
+
+	task_pool_t pool;
+	bool complete = true;
+	std::vector<gmp_candidate_t> gmps;
+	std::vector<scan_hit_t> loose;
+	std::vector<ea_t> ends;
+	std::vector<unsigned char> data;
+	for( size_t r = 0; r < ranges.size() && complete; ++r )
+	{
+		if( !snapshot( ranges[ r ], data ) )
+		{
+			complete = false;
+			break;
+		}
+		const size_t chunks = (data.size() + SCAN_CHUNK - 1) / SCAN_CHUNK;
+		std::vector<scan_chunk_t> found( chunks );
+
+		complete = pool.run( chunks, [&]( size_t t )
+		{
+			const size_t from = t * SCAN_CHUNK;
+			scan_chunk( data, ranges[ r ].start, from, std::min( data.size(), from + SCAN_CHUNK ), ranges, found[ t ] );
+		}, wasbreak );
+
+		for( size_t t = 0; t < chunks; ++t )
+		{
+			hits.insert( hits.end(), found[ t ].hits.begin(), found[ t ].hits.end() );
+			gmps.insert( gmps.end(), found[ t ].gmps.begin(), found[ t ].gmps.end() );
+			loose.insert( loose.end(), found[ t ].loose.begin(), found[ t ].loose.end() );
+			ends.insert( ends.end(), found[ t ].ends.begin(), found[ t ].ends.end() );
+		}
+	}
+
+	//INTEGERs preceded by another one, it may have been found by another task
+	std::sort( ends.begin(), ends.end() );
+	for( size_t i = 0; i < loose.size(); ++i )
+	{
+		if( std::binary_search( ends.begin(), ends.end(), loose[ i ].address ) )
+			hits.push_back( loose[ i ] );
+	}
+
+	//the limbs, on this thread because they are read from the database
+	std::vector<unsigned char> limbs;
+	for( size_t i = 0; i < gmps.size() && complete; ++i )
+	{
+		if( i % SCAN_BREAK_POLL == 0 && wasbreak() )
+		{
+			complete = false;
+			break;
+		}
+		const gmp_candidate_t & c = gmps[ i ];
+		limbs.resize( 4 * c.size );
+		if( !get_many_bytes( c.limbs, &limbs[ 0 ], limbs.size() ) )
+			continue;
+		//a normalised mpz never has a zero top limb
+		if( read_le32( &limbs[ limbs.size() - 4 ] ) == 0 )
+			continue;
+		scan_hit_t hit;
+		hit.address = c.address;
+		hit.preset = SCAN_GMP_PRESET;
+		mpz_import( hit.number.get_mpz_t(), c.size, -1, 4, -1, 0, &limbs[ 0 ] );
+		if( hit.number != 0 )
+			hits.push_back( hit );
+	}
+
+	std::stable_sort( hits.begin(), hits.end(), hit_less );
+	if( hits.size() > MAX_SCAN_HITS )
+	{
+		msg( "only the first %u of %u candidates are kept\n", (unsigned)MAX_SCAN_HITS, (unsigned)hits.size() );
+		hits.resize( MAX_SCAN_HITS );
+	}
+	return complete;
+}
@@ -0,0 +1,136 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#include <chrono>
+#include <thread>
+#include "task_pool.h"
+
+task_pool_t::task_pool_t( unsigned int threads ): nthreads( threads ), stop( false ), remaining( 0 )
+{
+	if( nthreads == 0 )
+		nthreads = std::thread::hardware_concurrency();
+	if( nthreads == 0 )
+		nthreads = 1;
+	for( unsigned int i = 0; i < nthreads; ++i )
+	{
+		queues.push_back( std::unique_ptr<queue_t>( new queue_t ) );
+	}
+}
+
+bool task_pool_t::pop( unsigned int worker, size_t & task )
+{
+	//own queue first, from the front
+	{
+		queue_t & q = *queues[ worker ];
+		std::lock_guard<std::mutex> guard( q.lock );
+		if( !q.tasks.empty() )
+		{
+			task = q.tasks.front();
+			q.tasks.pop_front();
+			return true;
+		}
+	}
+	//steal from the back of somebody else
+	for( unsigned int i = 1; i < nthreads; ++i )
+	{
+		queue_t & q = *queues[ (worker + i) % nthreads ];
+		std::lock_guard<std::mutex> guard( q.lock );
+		if( !q.tasks.empty() )
+		{
+			task = q.tasks.back();
+			q.tasks.pop_back();
+			return true;
+		}
+	}
+	return false;
+}
+
+void task_pool_t::worker( unsigned int id, const task_t & task )
+{
+	size_t t;
+	while( !stop && pop( id, t ) )
+	{
+		try
+		{
+			task( t );
+		}
+		catch( ... )
+		{
+			std::lock_guard<std::mutex> guard( error_lock );
+			if( !error )
+				error = std::current_exception();
+			stop = true;
+		}
+		if( --remaining == 0 )
+		{
+			std::lock_guard<std::mutex> guard( done_lock );
+			done.notify_all();
+		}
+	}
+}
+
+bool task_pool_t::run( size_t count, const task_t & task, bool( *interrupted )(void) )
+{
+	stop = false;
+	error = std::exception_ptr();
+	remaining = count;
+
+	//neighbouring tasks go to one worker, so the thieves take the far end
+	for( size_t t = 0; t < count; ++t )
+	{
+		queues[ t * nthreads / count ]->tasks.push_back( t );
+	}
+
+	std::vector<std::thread> workers;
+	for( unsigned int i = 0; i < nthreads; ++i )
+	{
+		workers.push_back( std::thread( &task_pool_t::worker, this, i, std::cref( task ) ) );
+	}
+
+	while( remaining > 0 && !stop )
+	{
+		std::unique_lock<std::mutex> guard( done_lock );
+		done.wait_for( guard, std::chrono::milliseconds( 50 ) );
+		guard.unlock();
+		if( remaining > 0 && interrupted && interrupted() )
+			stop = true;
+	}
+
+	for( size_t i = 0; i < workers.size(); ++i )
+	{
+		workers[ i ].join();
+	}
+
+	const bool interrupted_run = remaining > 0;
+	for( unsigned int i = 0; i < nthreads; ++i )
+	{
+		queues[ i ]->tasks.clear();
+	}
+
+	if( error )
+		std::rethrow_exception( error );
+
+	return !interrupted_run;
+}
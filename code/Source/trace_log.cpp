@@ -0,0 +1,254 @@
+/*
+Copyright (c) 2014
+Milan Bohacek <milan.bohacek+bignum@gmail.com>
+All rights reserved.
+
+==============================================================================
+
+This file is part of Bignum dumper.
+
+Bignum dumper is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+==============================================================================
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <pro.h>
+#include <fpro.h>
+#include "trace_log.h"
+
+#define LIMB_SIZE 8
+//a block is written when one of these is reached
+#define TRACE_BLOCK_ENTRIES 4096
+#define TRACE_BLOCK_LIMBS (1 << 20)
+
+bool trace_writer_t::open( const char * path, const unsigned char input_md5[ 16 ] )
+{
+	close();
+
+	trace_reader_t old;
+	if( trace_reader_t::is_trace_file( path ) )
+	{
+		if( !old.open( path ) || !old.complete() || memcmp( old.header().input_md5, input_md5, sizeof( old.header().input_md5 ) ) != 0 )
+			return false;
+	}
+	else
+	{
+		//anything else is overwritten only when it is empty
+		FILE * f = fopenRB( path );
+		if( f )
+		{
+			const bool empty = qfgetc( f ) == EOF;
+			qfclose( f );
+			if( !empty )
+				return false;
+		}
+	}
+	const bool append = old.size() > 0 || old.valid_size() > 0;
+	old.close();
+
+	file = append ? fopenA( path ) : fopenWB( path );
+	if( !file )
+		return false;
+	if( !append )
+	{
+		trace_file_header_t header;
+		memset( &header, 0, sizeof( header ) );
+		memcpy( header.magic, TRACE_FILE_MAGIC, sizeof( TRACE_FILE_MAGIC ) );
+		header.version = TRACE_FILE_VERSION;
+		memcpy( header.input_md5, input_md5, sizeof( header.input_md5 ) );
+		if( qfwrite( file, &header, sizeof( header ) ) != (ssize_t)sizeof( header ) || qflush( file ) != 0 )
+		{
+			close();
+			return false;
+		}
+	}
+	flushed_at = 0;
+	return true;
+}
+
+void trace_writer_t::close()
+{
+	if( !file )
+		return;
+	flush();
+	qfclose( file );
+	file = NULL;
+}
+
+bool trace_writer_t::append( const trace_hit_t & hit, const mpz_class & number )
+{
+	if( !file )
+		return false;
+
+	sequences.push_back( hit.sequence );
+	times.push_back( hit.time );
+	addresses.push_back( hit.address == BADADDR ? ~(uint64)0 : (uint64)hit.address );
+	call_sites.push_back( hit.call_site == BADADDR ? ~(uint64)0 : (uint64)hit.call_site );
+	signs.push_back( sgn( number ) );
+
+	const size_t used = limbs.size();
+	const size_t count = number == 0 ? 0 : (mpz_sizeinbase( number.get_mpz_t(), 2 ) + 8 * LIMB_SIZE - 1) / (8 * LIMB_SIZE);
+	limbs.resize( used + count * LIMB_SIZE );
+	if( count )
+	{
+		size_t written = 0;
+		mpz_export( &limbs[ used ], &written, -1, LIMB_SIZE, -1, 0, number.get_mpz_t() );
+	}
+	limbs_ends.push_back( limbs.size() / LIMB_SIZE );
+
+	if( sequences.size() >= TRACE_BLOCK_ENTRIES || limbs.size() >= TRACE_BLOCK_LIMBS * LIMB_SIZE )
+		return flush();
+	return true;
+}
+
+bool trace_writer_t::flush()
+{
+	if( !file )
+		return false;
+	if( sequences.empty() )
+		return true;
+
+	const size_t count = sequences.size();
+	trace_block_header_t header;
+	header.magic = TRACE_BLOCK_MAGIC;
+	header.count = count;
+	header.length = sizeof( header ) + (uint64)TRACE_COLUMNS * count * 8 + limbs.size();
+
+	//a block in one piece, the header first, so a torn block is recognized by its length
+	bool ok = qfwrite( file, &header, sizeof( header ) ) == (ssize_t)sizeof( header );
+	const std::vector<uint64> * columns[] = { &sequences, &times, &addresses, &call_sites, &limbs_ends };
+	for( size_t i = 0; ok && i < sizeof( columns ) / sizeof( *columns ); ++i )
+	{
+		ok = qfwrite( file, &(*columns[ i ])[ 0 ], 8 * count ) == (ssize_t)(8 * count);
+	}
+	ok = ok && qfwrite( file, &signs[ 0 ], 8 * count ) == (ssize_t)(8 * count);
+	if( ok && !limbs.empty() )
+		ok = qfwrite( file, &limbs[ 0 ], limbs.size() ) == (ssize_t)limbs.size();
+	ok = ok && qflush( file ) == 0;
+
+	flushed_at = times.back();
+	sequences.clear();
+	times.clear();
+	addresses.clear();
+	call_sites.clear();
+	limbs_ends.clear();
+	signs.clear();
+	limbs.clear();
+
+	if( !ok )
+	{
+		//the rest would follow a torn block, nobody could read it
+		qfclose( file );
+		file = NULL;
+	}
+	return ok;
+}
+
+bool trace_reader_t::is_trace_file( const char * path )
+{
+	char magic[ sizeof( TRACE_FILE_MAGIC ) ] = { 0 };
+	FILE * f = fopenRB( path );
+	if( !f )
+		return false;
+	const bool ok = qfread( f, magic, sizeof( magic ) ) == (ssize_t)sizeof( magic ) && memcmp( magic, TRACE_FILE_MAGIC, sizeof( magic ) ) == 0;
+	qfclose( f );
+	return ok;
+}
+
+void trace_reader_t::close()
+{
+	file.close();
+	blocks.clear();
+	valid_end = 0;
+}
+
+bool trace_reader_t::open( const char * path )
+{
+	close();
+	if( !file.open( path ) || file.size() < sizeof( trace_file_header_t ) )
+	{
+		close();
+		return false;
+	}
+	const trace_file_header_t & h = header();
+	if( memcmp( h.magic, TRACE_FILE_MAGIC, sizeof( h.magic ) ) != 0 || h.version != TRACE_FILE_VERSION )
+	{
+		close();
+		return false;
+	}
+
+	//only the block headers are read, the columns stay on the disk until get() needs them
+	uint64 first = 0;
+	size_t offset = sizeof( trace_file_header_t );
+	for( ;; )
+	{
+		const size_t left = file.size() - offset;
+		if( left < sizeof( trace_block_header_t ) )
+			break;
+		const trace_block_header_t & b = *(const trace_block_header_t *)(file.data() + offset);
+		if( b.magic != TRACE_BLOCK_MAGIC || b.length > left || b.length < sizeof( b ) + (uint64)TRACE_COLUMNS * b.count * 8 )
+			break;
+		block_t block;
+		block.first = first;
+		block.count = b.count;
+		block.offset = offset;
+		blocks.push_back( block );
+		first += b.count;
+		offset += (size_t)b.length;
+	}
+	valid_end = offset;
+	return true;
+}
+
+bool trace_reader_t::get( uint64 i, trace_hit_t & hit, mpz_class & number ) const
+{
+	block_t key;
+	key.first = i;
+	std::vector<block_t>::const_iterator block = std::upper_bound( blocks.begin(), blocks.end(), key,
+		[]( const block_t & a, const block_t & b ) { return a.first < b.first; } );
+	if( block == blocks.begin() )
+		return false;
+	--block;
+	const uint64 j = i - block->first;
+	if( j >= block->count )
+		return false;
+
+	const unsigned char * base = file.data() + block->offset;
+	const trace_block_header_t & b = *(const trace_block_header_t *)base;
+	const uint64 * columns = (const uint64 *)(base + sizeof( b ));
+	const uint64 n = b.count;
+	const uint64 limb_area = (b.length - sizeof( b ) - TRACE_COLUMNS * n * 8) / LIMB_SIZE;
+
+	const uint64 end = columns[ 4 * n + j ];
+	const uint64 start = j ? columns[ 4 * n + j - 1 ] : 0;
+	const int64 sign = (int64)columns[ 5 * n + j ];
+	if( start > end || end > limb_area )
+		return false;
+
+	hit.sequence = columns[ j ];
+	hit.time = columns[ n + j ];
+	hit.address = columns[ 2 * n + j ] == ~(uint64)0 ? BADADDR : (ea_t)columns[ 2 * n + j ];
+	hit.call_site = columns[ 3 * n + j ] == ~(uint64)0 ? BADADDR : (ea_t)columns[ 3 * n + j ];
+
+	const unsigned char * limbs = base + sizeof( b ) + TRACE_COLUMNS * n * 8;
+	if( end > start )
+		mpz_import( number.get_mpz_t(), (size_t)(end - start), -1, LIMB_SIZE, -1, 0, limbs + start * LIMB_SIZE );
+	else
+		number = 0;
+	if( sign < 0 )
+		number = -number;
+	return true;
+}